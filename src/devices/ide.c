@@ -9,6 +9,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -43,6 +44,18 @@
 #define DEV_LBA 0x40            /* Linear based addressing. */
 #define DEV_DEV 0x10            /* Select device: 0=master, 1=slave. */
 
+/* Timeouts, in timer ticks.  The ATA standards allow a disk as
+   long as 30 seconds to complete a reset. */
+#define IDLE_TIMEOUT (10 * TIMER_FREQ)          /* For BSY and DRQ to clear. */
+#define BUSY_TIMEOUT (30 * TIMER_FREQ)          /* For BSY to clear. */
+#define BUSY_WARNING (7 * TIMER_FREQ)           /* Before reporting BSY. */
+#define COMPLETION_TIMEOUT (30 * TIMER_FREQ)    /* For completion interrupt. */
+
+/* Number of times to poll the status register, 10 us apart,
+   before going to sleep between polls instead.  Commands on
+   virtual disks usually finish within that time. */
+#define STATUS_SPIN_CNT 20
+
 /* Commands.
    Many more are defined but this is the small subset that we
    use. */
@@ -70,7 +83,8 @@ struct channel
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
-    struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    bool completed;             /* Interrupt received, waiter not yet woken. */
+    struct semaphore completion_wait;   /* Up'd by completion softirq. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -90,12 +104,17 @@ static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
+static bool wait_for_completion (struct channel *);
+static bool wait_status_clear (const struct ata_disk *, uint16_t port,
+                               uint8_t mask, int64_t timeout,
+                               int64_t warning);
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static softirq_func completion_softirq;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -103,6 +122,7 @@ ide_init (void)
 {
   size_t chan_no;
 
+  softirq_register (SOFTIRQ_BLOCK, completion_softirq);
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
       struct channel *c = &channels[chan_no];
@@ -123,8 +143,9 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init_named (&c->lock, c->name);
       c->expecting_interrupt = false;
+      c->completed = false;
       sema_init (&c->completion_wait, 0);
  
       /* Initialize devices. */
@@ -211,11 +232,11 @@ reset_channel (struct channel *c)
       int i;
 
       select_device (&c->devices[1]);
-      for (i = 0; i < 3000; i++) 
+      for (i = 0; i < BUSY_TIMEOUT; i++) 
         {
           if (inb (reg_nsect (c)) == 1 && inb (reg_lbal (c)) == 1)
             break;
-          timer_msleep (10);
+          timer_sleep (1);
         }
       wait_while_busy (&c->devices[1]);
     }
@@ -273,8 +294,7 @@ identify_ata_device (struct ata_disk *d)
      into our buffer. */
   select_device_wait (d);
   issue_pio_command (c, CMD_IDENTIFY_DEVICE);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
+  if (!wait_for_completion (c) || !wait_while_busy (d))
     {
       d->is_ata = false;
       return;
@@ -349,8 +369,7 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
   lock_acquire (&c->lock);
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
+  if (!wait_for_completion (c) || !wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
   lock_release (&c->lock);
@@ -372,7 +391,8 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  if (!wait_for_completion (c))
+    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   lock_release (&c->lock);
 }
 
@@ -432,24 +452,85 @@ output_sector (struct channel *c, const void *sector)
 
 /* Low-level ATA primitives. */
 
-/* Wait up to 10 seconds for the controller to become idle, that
-   is, for the BSY and DRQ bits to clear in the status register.
+/* Sleeps until channel C's completion interrupt arrives, for up
+   to COMPLETION_TIMEOUT.  Returns true if it arrived, false if
+   the time ran out.
 
-   As a side effect, reading the status register clears any
-   pending interrupt. */
-static void
-wait_until_idle (const struct ata_disk *d) 
+   On timeout, forgets any completion that arrived too late,
+   whether or not the softirq has passed it on yet, so that it
+   does not satisfy the wait for the channel's next command. */
+static bool
+wait_for_completion (struct channel *c)
+{
+  enum intr_level old_level;
+
+  if (sema_down_timeout (&c->completion_wait, COMPLETION_TIMEOUT))
+    return true;
+
+  printf ("%s: command completion timeout\n", c->name);
+  old_level = intr_disable ();
+  c->expecting_interrupt = false;
+  c->completed = false;
+  sema_try_down (&c->completion_wait);
+  intr_set_level (old_level);
+  return false;
+}
+
+/* Reads status register PORT of disk D's channel until the bits
+   in MASK are all clear, for up to TIMEOUT timer ticks.  Spins
+   for a few microseconds first, then sleeps a tick at a time
+   between reads, so that a slow disk does not tie up the CPU.
+   If WARNING is positive and the bits are still set after that
+   many ticks, says so on the console.  Returns true if the bits
+   cleared, false on timeout. */
+static bool
+wait_status_clear (const struct ata_disk *d, uint16_t port, uint8_t mask,
+                   int64_t timeout, int64_t warning)
 {
+  int64_t start;
+  bool warned = false;
   int i;
 
-  for (i = 0; i < 1000; i++) 
+  for (i = 0; i < STATUS_SPIN_CNT; i++)
     {
-      if ((inb (reg_status (d->channel)) & (STA_BSY | STA_DRQ)) == 0)
-        return;
+      if ((inb (port) & mask) == 0)
+        return true;
       timer_usleep (10);
     }
 
-  printf ("%s: idle timeout\n", d->name);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < timeout)
+    {
+      if (warning > 0 && !warned && timer_elapsed (start) >= warning)
+        {
+          printf ("%s: busy, waiting...", d->name);
+          warned = true;
+        }
+      timer_sleep (1);
+      if ((inb (port) & mask) == 0)
+        {
+          if (warned)
+            printf ("ok\n");
+          return true;
+        }
+    }
+
+  if (warned)
+    printf ("failed\n");
+  return false;
+}
+
+/* Wait up to 10 seconds for the controller to become idle, that
+   is, for the BSY and DRQ bits to clear in the status register.
+
+   As a side effect, reading the status register clears any
+   pending interrupt. */
+static void
+wait_until_idle (const struct ata_disk *d) 
+{
+  if (!wait_status_clear (d, reg_status (d->channel), STA_BSY | STA_DRQ,
+                          IDLE_TIMEOUT, 0))
+    printf ("%s: idle timeout\n", d->name);
 }
 
 /* Wait up to 30 seconds for disk D to clear BSY,
@@ -460,23 +541,11 @@ static bool
 wait_while_busy (const struct ata_disk *d) 
 {
   struct channel *c = d->channel;
-  int i;
-  
-  for (i = 0; i < 3000; i++)
-    {
-      if (i == 700)
-        printf ("%s: busy, waiting...", d->name);
-      if (!(inb (reg_alt_status (c)) & STA_BSY)) 
-        {
-          if (i >= 700)
-            printf ("ok\n");
-          return (inb (reg_alt_status (c)) & STA_DRQ) != 0;
-        }
-      timer_msleep (10);
-    }
 
-  printf ("failed\n");
-  return false;
+  if (!wait_status_clear (d, reg_alt_status (c), STA_BSY,
+                          BUSY_TIMEOUT, BUSY_WARNING))
+    return false;
+  return (inb (reg_alt_status (c)) & STA_DRQ) != 0;
 }
 
 /* Program D's channel so that D is now the selected disk. */
@@ -514,7 +583,8 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
-            sema_up (&c->completion_wait);      /* Wake up waiter. */
+            c->completed = true;                /* Wake up waiter, later. */
+            softirq_raise (SOFTIRQ_BLOCK);
           }
         else
           printf ("%s: unexpected interrupt\n", c->name);
@@ -524,4 +594,21 @@ interrupt_handler (struct intr_frame *f)
   NOT_REACHED ();
 }
 
+/* Block completion softirq.  Wakes up the waiter on each channel
+   that has interrupted since the last time it ran. */
+static void
+completion_softirq (void)
+{
+  struct channel *c;
+
+  for (c = channels; c < channels + CHANNEL_CNT; c++)
+    {
+      enum intr_level old_level = intr_disable ();
+      bool completed = c->completed;
+      c->completed = false;
+      intr_set_level (old_level);
 
+      if (completed)
+        sema_up (&c->completion_wait);
+    }
+}
@@ -10,7 +10,7 @@ static void signal (struct intq *q, struct thread **waiter);
 void
 intq_init (struct intq *q) 
 {
-  lock_init (&q->lock);
+  lock_init_named (&q->lock, "intq");
   q->not_full = q->not_empty = NULL;
   q->head = q->tail = 0;
 }
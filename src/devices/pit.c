@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,45 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts a one-shot countdown of COUNT PIT cycles on CHANNEL,
+   using mode 0 (interrupt on terminal count): the channel's
+   output rises, raising a single interrupt on channel 0, once
+   the count runs out, and nothing further happens until the
+   channel is reprogrammed.  COUNT must be between 1 and 65536,
+   so the longest countdown is about 55 ms. */
+void
+pit_start_countdown (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (count >= 1 && count <= 65536);
+
+  /* A count of 65536 is loaded as 0. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of PIT cycles left in CHANNEL's current
+   count, using the counter latch command so that the two bytes
+   are read consistently. */
+unsigned
+pit_read_counter (int channel)
+{
+  enum intr_level old_level;
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_start_countdown (int channel, unsigned count);
+unsigned pit_read_counter (int channel);
 
 #endif /* devices/pit.h */
@@ -4,8 +4,14 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -93,6 +99,8 @@ shutdown_power_off (void)
 #ifdef FILESYS
   filesys_done ();
 #endif
+  trace_dump ();
+  profile_dump ();
 
   print_stats ();
 
@@ -123,9 +131,15 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lockstat_print_stats ();
+  palloc_print_stats ();
+  kmem_print_stats ();
+  trace_print_stats ();
+  profile_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
+  intr_print_stats ();
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
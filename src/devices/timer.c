@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -20,6 +21,31 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* PIT cycles per timer tick. */
+#define TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot countdown the 16-bit PIT counter can hold,
+   in whole ticks. */
+#define IDLE_MAX_TICKS (65536 / TICK_COUNT)
+
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second even when the CPU is idle.
+   If true, the idle thread stops the periodic tick until the
+   next sleeping thread is due, or as long as the PIT allows.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Number of timer interrupts per tick, normally 1.  More
+   interrupts let the profiler take more samples, but only every
+   TIMER_SUBTICKS'th interrupt counts as a tick.
+   Controlled by kernel command-line option "-profile-rate". */
+int timer_subticks = 1;
+static int subtick;             /* Interrupts since the last tick. */
+
+/* Tickless idle state. */
+static int64_t idle_countdown;  /* Ticks in current idle countdown, 0 if periodic. */
+static int64_t idle_skipped;    /* # of timer interrupts skipped while idle. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,13 +55,16 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void idle_exit (int64_t elapsed);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void)
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  ASSERT (timer_subticks >= 1 && timer_subticks <= TIMER_SUBTICKS_MAX);
+
+  pit_configure_channel (0, 2, TIMER_FREQ * timer_subticks);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -165,12 +194,87 @@ void
 timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" idle interrupts skipped\n", idle_skipped);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick
+   by a single countdown that expires at tick WAKEUP, or as late
+   as the PIT allows if that is sooner. */
+void
+timer_idle_enter (int64_t wakeup)
+{
+  int64_t idle = wakeup - ticks;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || idle_countdown != 0)
+    return;
+
+  if (idle > IDLE_MAX_TICKS)
+    idle = IDLE_MAX_TICKS;
+  if (idle <= 1)
+    return;
+
+  idle_countdown = idle;
+  pit_start_countdown (0, idle * TICK_COUNT);
+}
+
+/* Called for every external interrupt other than the timer's.
+   If the CPU was idling without a tick, restores the periodic
+   tick and credits the ticks that passed in the meantime. */
+void
+timer_idle_interrupted (void)
+{
+  unsigned left;
+
+  if (idle_countdown == 0)
+    return;
+
+  left = pit_read_counter (0);
+  if (left > idle_countdown * TICK_COUNT)
+    {
+      /* The countdown ran out and wrapped around, so its
+         interrupt is pending and will supply the last tick. */
+      idle_exit (idle_countdown - 1);
+    }
+  else
+    idle_exit ((idle_countdown * TICK_COUNT - left) / TICK_COUNT);
+}
+
+/* Ends a tickless idle period in which ELAPSED whole ticks went
+   by without a timer interrupt. */
+static void
+idle_exit (int64_t elapsed)
+{
+  idle_countdown = 0;
+  subtick = 0;
+  pit_configure_channel (0, 2, TIMER_FREQ * timer_subticks);
+
+  if (elapsed > 0)
+    {
+      ticks += elapsed;
+      idle_skipped += elapsed;
+      thread_tick_skipped (elapsed);
+    }
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  if (profile_enabled)
+    profile_sample (args);
+
+  /* An expired idle countdown stands for all of its ticks,
+     the last of which is this interrupt. */
+  if (idle_countdown != 0)
+    idle_exit (idle_countdown - 1);
+  else if (++subtick < timer_subticks)
+    return;
+  subtick = 0;
+
   ticks++;
   thread_tick ();
 }
@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -26,4 +27,13 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Tickless idle. */
+extern bool timer_tickless;
+void timer_idle_enter (int64_t wakeup);
+void timer_idle_interrupted (void);
+
+/* Timer interrupts per tick, for sampling. */
+#define TIMER_SUBTICKS_MAX 100
+extern int timer_subticks;
+
 #endif /* devices/timer.h */
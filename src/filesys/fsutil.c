@@ -1,5 +1,7 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -154,6 +156,12 @@ fsutil_extract (char **argv UNUSED)
   free (header);
 }
 
+/* Next sector on the scratch device for fsutil_append() and
+   fsutil_append_data() to write. */
+static block_sector_t append_sector;
+
+static void write_end_of_archive (struct block *, void *buffer);
+
 /* Copies file FILE_NAME from the file system to the scratch
    device, in ustar format.
 
@@ -165,8 +173,6 @@ fsutil_extract (char **argv UNUSED)
 void
 fsutil_append (char **argv)
 {
-  static block_sector_t sector = 0;
-
   const char *file_name = argv[1];
   void *buffer;
   struct file *src;
@@ -194,29 +200,90 @@ fsutil_append (char **argv)
   /* Write ustar header to first sector. */
   if (!ustar_make_header (file_name, USTAR_REGULAR, size, buffer))
     PANIC ("%s: name too long for ustar format", file_name);
-  block_write (dst, sector++, buffer);
+  block_write (dst, append_sector++, buffer);
 
   /* Do copy. */
   while (size > 0) 
     {
       int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
-      if (sector >= block_size (dst))
+      if (append_sector >= block_size (dst))
         PANIC ("%s: out of space on scratch device", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
       memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-      block_write (dst, sector++, buffer);
+      block_write (dst, append_sector++, buffer);
       size -= chunk_size;
     }
 
-  /* Write ustar end-of-archive marker, which is two consecutive
-     sectors full of zeros.  Don't advance our position past
-     them, though, in case we have more files to append. */
-  memset (buffer, 0, BLOCK_SECTOR_SIZE);
-  block_write (dst, sector, buffer);
-  block_write (dst, sector, buffer + 1);
+  write_end_of_archive (dst, buffer);
 
   /* Finish up. */
   file_close (src);
   free (buffer);
 }
+
+/* Writes the SIZE bytes at DATA to the scratch device as a file
+   named FILE_NAME, in ustar format, following whatever earlier
+   calls to this function and fsutil_append() wrote there.
+   Unlike fsutil_append(), does not need the file system.
+   Returns true if successful, false if the scratch device is
+   missing or too small or memory is exhausted. */
+bool
+fsutil_append_data (const char *file_name, const void *data, size_t size)
+{
+  const uint8_t *src = data;
+  struct block *dst;
+  void *buffer;
+
+  printf ("Appending '%s' to ustar archive on scratch device...\n", file_name);
+
+  dst = block_get_role (BLOCK_SCRATCH);
+  if (dst == NULL)
+    return false;
+  if (append_sector + 1 + DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE)
+      > block_size (dst))
+    return false;
+
+  buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return false;
+
+  if (!ustar_make_header (file_name, USTAR_REGULAR, size, buffer))
+    {
+      free (buffer);
+      return false;
+    }
+  block_write (dst, append_sector++, buffer);
+
+  for (; size >= BLOCK_SECTOR_SIZE; size -= BLOCK_SECTOR_SIZE)
+    {
+      block_write (dst, append_sector++, src);
+      src += BLOCK_SECTOR_SIZE;
+    }
+  if (size > 0)
+    {
+      memcpy (buffer, src, size);
+      memset (buffer + size, 0, BLOCK_SECTOR_SIZE - size);
+      block_write (dst, append_sector++, buffer);
+    }
+
+  write_end_of_archive (dst, buffer);
+  free (buffer);
+  return true;
+}
+
+/* Writes the ustar end-of-archive marker, which is two
+   consecutive sectors full of zeros, to DST using BUFFER, which
+   must be BLOCK_SECTOR_SIZE bytes long.  Doesn't advance our
+   position past them, though, in case we have more files to
+   append, and writes only as much of the marker as fits. */
+static void
+write_end_of_archive (struct block *dst, void *buffer)
+{
+  block_sector_t sector;
+
+  memset (buffer, 0, BLOCK_SECTOR_SIZE);
+  for (sector = append_sector;
+       sector < append_sector + 2 && sector < block_size (dst); sector++)
+    block_write (dst, sector, buffer);
+}
@@ -5,7 +5,11 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -32,6 +36,7 @@ bytes_to_sectors (off_t size)
 struct inode 
   {
     struct list_elem elem;              /* Element in inode list. */
+    struct rcu_head rcu;                /* For freeing after unlinking. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
@@ -54,14 +59,24 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Lookups run locklessly under
+   RCU; insertions and removals hold open_inodes_lock. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/* Cache of `struct inode's. */
+static struct kmem_cache *inode_cache;
+
+static struct inode *lookup_open_inode (block_sector_t);
+static void free_inode (struct rcu_head *);
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init_named (&open_inodes_lock, "open_inodes");
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,42 +126,82 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
-  struct inode *inode;
+  struct inode *inode, *found;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  inode = lookup_open_inode (sector);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize, reading the disk without holding the lock, so
+     that other opens and closes need not wait for it. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+
+  /* Check again, now excluding other openers, since one may have
+     opened the same inode meanwhile, and publish the new inode
+     only if none did. */
+  lock_acquire (&open_inodes_lock);
+  found = lookup_open_inode (sector);
+  if (found == NULL)
+    list_push_front_rcu (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
+
+  if (found != NULL)
+    {
+      kmem_cache_free (inode_cache, inode);
+      inode = found;
+    }
   return inode;
 }
 
+/* Looks for an open inode for SECTOR without taking any lock,
+   and reopens and returns it if there is one.  Returns a null
+   pointer otherwise.  An inode whose last opener is closing it
+   does not count. */
+static struct inode *
+lookup_open_inode (block_sector_t sector)
+{
+  struct inode *found = NULL;
+  struct list_elem *e;
+
+  rcu_read_lock ();
+  for (e = list_begin_rcu (&open_inodes); e != list_end (&open_inodes);
+       e = list_next_rcu (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector && inode->open_cnt > 0)
+        {
+          /* Readers are not preempted, so this cannot race with
+             inode_close(). */
+          inode->open_cnt++;
+          found = inode;
+          break;
+        }
+    }
+  rcu_read_unlock ();
+
+  return found;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -163,16 +218,26 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  /* Drop our reference.  Once the count reaches 0, lookups skip
+     the inode, so no one else can reopen it. */
+  lock_acquire (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+  if (last)
+    list_remove_rcu (&inode->elem);
+  lock_release (&open_inodes_lock);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
@@ -181,10 +246,18 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      /* Lookups may still be looking at it. */
+      call_rcu (&inode->rcu, free_inode);
     }
 }
 
+/* Frees the inode that contains HEAD, once no lookup can see it. */
+static void
+free_inode (struct rcu_head *head)
+{
+  kmem_cache_free (inode_cache, rcu_entry (head, struct inode, rcu));
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
    has it open. */
 void
@@ -0,0 +1,192 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Pairing heap.
+
+   The heap is a tree in which every element is no less than its
+   parent.  Each element points to its first child, and the
+   children of an element form a doubly linked list through
+   `next' and `prev', except that the first child's `prev'
+   points to the parent instead.  That back pointer is what lets
+   heap_remove() unlink an arbitrary element.
+
+   See M. L. Fredman, R. Sedgewick, D. D. Sleator, and
+   R. E. Tarjan, "The Pairing Heap: A New Form of Self-Adjusting
+   Heap", Algorithmica 1 (1986), for the analysis. */
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap that compares elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? meld (h, h->root, e) : e;
+  h->elem_cnt++;
+}
+
+/* Removes the minimum element from H and returns it.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_pop_min (struct heap *h)
+{
+  struct heap_elem *min;
+
+  ASSERT (h != NULL);
+  ASSERT (h->root != NULL);
+
+  min = h->root;
+  h->root = merge_pairs (h, min->child);
+  h->elem_cnt--;
+
+  min->child = NULL;
+  return min;
+}
+
+/* Removes E, which must be an element of H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *subheap;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  if (e == h->root)
+    {
+      heap_pop_min (h);
+      return;
+    }
+
+  /* Unlink E and its subtree from E's parent. */
+  ASSERT (e->prev != NULL);
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+
+  /* Put E's children back into the heap. */
+  subheap = merge_pairs (h, e->child);
+  if (subheap != NULL)
+    h->root = meld (h, h->root, subheap);
+  e->child = NULL;
+  h->elem_cnt--;
+}
+
+/* Returns the minimum element in H, or a null pointer if H is
+   empty. */
+struct heap_elem *
+heap_min (const struct heap *h)
+{
+  return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return h->root == NULL;
+}
+
+/* Combines the heaps rooted at A and B, neither of which may
+   have siblings, and returns the root of the result. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  struct heap_elem *parent, *child;
+
+  ASSERT (a->next == NULL && a->prev == NULL);
+  ASSERT (b->next == NULL && b->prev == NULL);
+
+  if (h->less (b, a, h->aux))
+    {
+      parent = b;
+      child = a;
+    }
+  else
+    {
+      parent = a;
+      child = b;
+    }
+
+  child->next = parent->child;
+  if (parent->child != NULL)
+    parent->child->prev = child;
+  child->prev = parent;
+  parent->child = child;
+
+  return parent;
+}
+
+/* Combines the sibling list that starts at FIRST into a single
+   heap, using the standard two passes: meld the siblings in
+   pairs from left to right, then meld the pairs together from
+   right to left.  Returns the root, or a null pointer if FIRST
+   is null. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* First pass.  The melded pairs are pushed onto a stack
+     linked through `next', so that the second pass visits them
+     from right to left. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = meld (h, a, b);
+        }
+
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass. */
+  while (pairs != NULL)
+    {
+      struct heap_elem *a = pairs;
+
+      pairs = a->next;
+      a->next = NULL;
+      root = root != NULL ? meld (h, a, root) : a;
+    }
+
+  return root;
+}
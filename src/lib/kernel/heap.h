@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+
+   This is a pairing heap.  Insertion and finding the minimum
+   take O(1) time, removing the minimum or any other element
+   takes O(log n) amortized time, and none of them require
+   dynamic allocation.  Instead, each structure that can
+   potentially be in a heap must embed a struct heap_elem
+   member.  All of the heap functions operate on these `struct
+   heap_elem's.  The heap_entry macro allows conversion from a
+   struct heap_elem back to a structure object that contains it.
+   This is the same technique used in the linked list
+   implementation.  Refer to lib/kernel/list.h for a detailed
+   explanation.
+
+   The "minimum" is the element that no other element is less
+   than according to the heap's comparison function.  Elements
+   that compare equal come out in no particular order, so a
+   caller that needs ties broken in insertion order has to make
+   the comparison function do it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* First child. */
+    struct heap_elem *next;     /* Next sibling. */
+    struct heap_elem *prev;     /* Previous sibling, or parent if first child. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Minimum element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and deletion. */
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Information. */
+struct heap_elem *heap_min (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
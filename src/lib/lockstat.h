@@ -0,0 +1,28 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+/* Lock contention statistics, shared between the kernel, which
+   keeps them, and user programs, which read them with the
+   lockstat() system call.
+
+   Statistics are kept per lock name, not per lock, so that all
+   the locks of a kind (every malloc arena's lock, say) add up
+   together.  Times are in CPU time-stamp counter cycles. */
+
+#include <stdint.h>
+
+/* Longest lock name, not counting the null terminator. */
+#define LOCKSTAT_NAME_MAX 15
+
+struct lockstat
+  {
+    char name[LOCKSTAT_NAME_MAX + 1];   /* Lock name. */
+    unsigned acquisitions;      /* Times acquired. */
+    unsigned contended;         /* Times acquired after waiting. */
+    uint64_t wait_total;        /* Total time spent waiting. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_total;        /* Total time held. */
+    uint64_t hold_max;          /* Longest hold. */
+  };
+
+#endif /* lib/lockstat.h */
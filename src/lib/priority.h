@@ -0,0 +1,11 @@
+#ifndef __LIB_PRIORITY_H
+#define __LIB_PRIORITY_H
+
+/* Thread priorities, shared between the kernel, which schedules
+   by them, and user programs, which pass them to the
+   sched_latency() system call. */
+#define PRI_MIN 0                       /* Lowest priority. */
+#define PRI_DEFAULT 31                  /* Default priority. */
+#define PRI_MAX 63                      /* Highest priority. */
+
+#endif /* lib/priority.h */
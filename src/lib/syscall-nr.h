@@ -18,6 +18,9 @@ enum
     SYS_TELL,                   /* Report current position in a file. */
     SYS_CLOSE,                  /* Close a file. */
     SYS_NULL,                   /* Returns arg incremented by 1 */
+    SYS_SCHED_LATENCY,          /* Read a scheduling latency histogram. */
+    SYS_PROFILE,                /* Start or stop the profiler. */
+    SYS_LOCKSTAT,               /* Read lock contention statistics. */
 
   };
 
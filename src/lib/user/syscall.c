@@ -67,6 +67,24 @@ null (int i)
   return syscall1(SYS_NULL, i);
 }
 
+int
+sched_latency (int priority, unsigned counts[], int cnt)
+{
+  return syscall3 (SYS_SCHED_LATENCY, priority, counts, cnt);
+}
+
+bool
+profile (bool enable)
+{
+  return syscall1 (SYS_PROFILE, enable);
+}
+
+bool
+lockstat (int idx, struct lockstat *ls)
+{
+  return syscall2 (SYS_LOCKSTAT, idx, ls);
+}
+
 void
 halt (void) 
 {
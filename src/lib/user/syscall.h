@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <priority.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -34,5 +36,8 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 int null (int i);
+int sched_latency (int priority, unsigned counts[], int cnt);
+bool profile (bool enable);
+bool lockstat (int idx, struct lockstat *);
 
 #endif
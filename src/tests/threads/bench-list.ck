@@ -0,0 +1,4 @@
+# -*- perl -*-
+use tests::tests;
+use tests::threads::bench;
+check_bench (map ("list-sort-$_", 16, 256, 4096));
@@ -0,0 +1,4 @@
+# -*- perl -*-
+use tests::tests;
+use tests::threads::bench;
+check_bench ('lock-uncontended', 'lock-contended');
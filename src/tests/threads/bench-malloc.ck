@@ -0,0 +1,5 @@
+# -*- perl -*-
+use tests::tests;
+use tests::threads::bench;
+check_bench (map (("malloc-free-$_", "malloc-free-pair-$_"),
+		  16, 32, 64, 128, 256, 512, 1024, 2048));
@@ -0,0 +1,374 @@
+/* Kernel microbenchmarks.  Each test times a kernel primitive
+   with the CPU's time-stamp counter and reports the mean cost of
+   one operation as a line of the form
+
+        (bench-NAME) BENCH <key> <cycles> cycles/op
+
+   which utils/bench-compare can compare against a saved
+   baseline.  These tests pass as long as they run to completion;
+   they do not judge the numbers. */
+
+#include <hash.h>
+#include <list.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+#include "devices/timer.h"
+
+/* Reports that CNT operations named KEY took CYCLES in all. */
+static void
+bench_report (const char *key, uint64_t cycles, unsigned cnt)
+{
+  msg ("BENCH %s %llu cycles/op", key, cycles / cnt);
+}
+
+/* Context switches. */
+
+#define SWITCH_CNT 1000
+
+static struct semaphore ping, pong;
+
+static void
+pong_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < SWITCH_CNT; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
+
+/* Measures a context switch, as half of a round trip between two
+   threads that wake each other with semaphores. */
+void
+test_bench_switch (void)
+{
+  uint64_t start;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, NULL);
+
+  start = rdtsc ();
+  for (i = 0; i < SWITCH_CNT; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  bench_report ("sema-switch", rdtsc () - start, SWITCH_CNT * 2);
+}
+
+/* Locks. */
+
+#define LOCK_CNT 10000
+#define CONTENDED_CNT 1000
+
+static struct lock bench_lock;
+static struct semaphore contender_done;
+
+static void
+contender_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < CONTENDED_CNT; i++)
+    {
+      lock_acquire (&bench_lock);
+      thread_yield ();
+      lock_release (&bench_lock);
+      thread_yield ();
+    }
+  sema_up (&contender_done);
+}
+
+/* Measures acquiring and releasing a lock, both when no other
+   thread wants it and when two threads of the same priority take
+   turns holding it.  Each yields both while holding the lock, so
+   that the other blocks acquiring it, and after releasing it, so
+   that the other can take it before it tries again. */
+void
+test_bench_lock (void)
+{
+  uint64_t start;
+  int i;
+
+  lock_init (&bench_lock);
+  start = rdtsc ();
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      lock_acquire (&bench_lock);
+      lock_release (&bench_lock);
+    }
+  bench_report ("lock-uncontended", rdtsc () - start, LOCK_CNT);
+
+  sema_init (&contender_done, 0);
+  thread_create ("contender", PRI_DEFAULT, contender_thread, NULL);
+  start = rdtsc ();
+  for (i = 0; i < CONTENDED_CNT; i++)
+    {
+      lock_acquire (&bench_lock);
+      thread_yield ();
+      lock_release (&bench_lock);
+      thread_yield ();
+    }
+  sema_down (&contender_done);
+  bench_report ("lock-contended", rdtsc () - start, CONTENDED_CNT * 2);
+}
+
+/* Thread creation. */
+
+#define THREAD_CNT 200
+
+static void
+exit_thread (void *aux UNUSED)
+{
+}
+
+/* Measures creating a thread that runs at once and exits. */
+void
+test_bench_thread (void)
+{
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    thread_create ("exit", PRI_DEFAULT + 1, exit_thread, NULL);
+  bench_report ("thread-create-exit", rdtsc () - start, THREAD_CNT);
+}
+
+/* Memory allocators. */
+
+#define ALLOC_BATCH 64
+#define ALLOC_ROUNDS 50
+#define ALLOC_PAIRS 5000
+
+/* Measures malloc() and free() of blocks in each size class, and
+   of blocks too big for any, in two ways: in batches, so that
+   arenas are created and released as well as reused, and in
+   pairs of malloc() and free() of the same block, the common case
+   of a short-lived allocation, which should be served from the
+   thread's magazine. */
+void
+test_bench_malloc (void)
+{
+  size_t size;
+
+  for (size = 16; size <= 2048; size *= 2)
+    {
+      void *blocks[ALLOC_BATCH];
+      uint64_t start;
+      char key[32];
+      int round, i;
+
+      start = rdtsc ();
+      for (round = 0; round < ALLOC_ROUNDS; round++)
+        {
+          for (i = 0; i < ALLOC_BATCH; i++)
+            {
+              blocks[i] = malloc (size);
+              if (blocks[i] == NULL)
+                fail ("malloc (%zu) failed", size);
+            }
+          for (i = 0; i < ALLOC_BATCH; i++)
+            free (blocks[i]);
+        }
+      snprintf (key, sizeof key, "malloc-free-%zu", size);
+      bench_report (key, rdtsc () - start, ALLOC_ROUNDS * ALLOC_BATCH);
+
+      start = rdtsc ();
+      for (i = 0; i < ALLOC_PAIRS; i++)
+        {
+          void *block = malloc (size);
+          if (block == NULL)
+            fail ("malloc (%zu) failed", size);
+          free (block);
+        }
+      snprintf (key, sizeof key, "malloc-free-pair-%zu", size);
+      bench_report (key, rdtsc () - start, ALLOC_PAIRS);
+    }
+}
+
+/* Measures palloc_get_page() and palloc_free_page(). */
+void
+test_bench_palloc (void)
+{
+  void *pages[ALLOC_BATCH];
+  uint64_t start;
+  int round, i;
+
+  start = rdtsc ();
+  for (round = 0; round < ALLOC_ROUNDS; round++)
+    {
+      for (i = 0; i < ALLOC_BATCH; i++)
+        {
+          pages[i] = palloc_get_page (0);
+          if (pages[i] == NULL)
+            fail ("palloc_get_page failed");
+        }
+      for (i = 0; i < ALLOC_BATCH; i++)
+        palloc_free_page (pages[i]);
+    }
+  bench_report ("palloc-get-free", rdtsc () - start,
+                ALLOC_ROUNDS * ALLOC_BATCH);
+}
+
+/* Timer sleep. */
+
+#define SLEEP_CNT 50
+
+/* Measures how long timer_sleep(1) takes when called just after
+   a tick, which should be one tick's worth of cycles, and its
+   jitter, as the mean absolute deviation from that mean. */
+void
+test_bench_sleep (void)
+{
+  uint64_t samples[SLEEP_CNT];
+  uint64_t total = 0, deviation = 0, mean;
+  int i;
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t tick = timer_ticks ();
+      uint64_t start;
+
+      /* Start right after a tick. */
+      while (timer_ticks () == tick)
+        barrier ();
+      start = rdtsc ();
+      timer_sleep (1);
+      samples[i] = rdtsc () - start;
+      total += samples[i];
+    }
+  mean = total / SLEEP_CNT;
+  for (i = 0; i < SLEEP_CNT; i++)
+    deviation += samples[i] > mean ? samples[i] - mean : mean - samples[i];
+
+  bench_report ("timer-sleep-1", total, SLEEP_CNT);
+  bench_report ("timer-sleep-1-jitter", deviation, SLEEP_CNT);
+}
+
+/* Lists and hash tables. */
+
+/* An element with a random key. */
+struct bench_elem
+  {
+    struct list_elem list_elem;
+    struct hash_elem hash_elem;
+    unsigned long key;
+  };
+
+/* Sizes of the lists and hash tables to test. */
+static const int container_sizes[] = {16, 256, 4096};
+#define CONTAINER_SIZE_CNT (sizeof container_sizes / sizeof *container_sizes)
+
+/* Allocates CNT elements with random keys. */
+static struct bench_elem *
+make_elems (int cnt)
+{
+  struct bench_elem *elems = malloc (sizeof *elems * cnt);
+  int i;
+
+  if (elems == NULL)
+    fail ("out of memory");
+  for (i = 0; i < cnt; i++)
+    elems[i].key = random_ulong ();
+  return elems;
+}
+
+static bool
+list_key_less (const struct list_elem *a_, const struct list_elem *b_,
+               void *aux UNUSED)
+{
+  const struct bench_elem *a = list_entry (a_, struct bench_elem, list_elem);
+  const struct bench_elem *b = list_entry (b_, struct bench_elem, list_elem);
+
+  return a->key < b->key;
+}
+
+/* Measures list_sort() of lists of random keys, per element. */
+void
+test_bench_list (void)
+{
+  size_t s;
+
+  random_init (0);
+  for (s = 0; s < CONTAINER_SIZE_CNT; s++)
+    {
+      int cnt = container_sizes[s];
+      struct bench_elem *elems = make_elems (cnt);
+      struct list list;
+      uint64_t start;
+      char key[32];
+      int i;
+
+      list_init (&list);
+      for (i = 0; i < cnt; i++)
+        list_push_back (&list, &elems[i].list_elem);
+
+      start = rdtsc ();
+      list_sort (&list, list_key_less, NULL);
+      snprintf (key, sizeof key, "list-sort-%d", cnt);
+      bench_report (key, rdtsc () - start, cnt);
+
+      free (elems);
+    }
+}
+
+static unsigned
+hash_key (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct bench_elem *b = hash_entry (e, struct bench_elem, hash_elem);
+
+  return hash_bytes (&b->key, sizeof b->key);
+}
+
+static bool
+hash_key_less (const struct hash_elem *a_, const struct hash_elem *b_,
+               void *aux UNUSED)
+{
+  const struct bench_elem *a = hash_entry (a_, struct bench_elem, hash_elem);
+  const struct bench_elem *b = hash_entry (b_, struct bench_elem, hash_elem);
+
+  return a->key < b->key;
+}
+
+/* Measures hash_insert() of random keys into a table that starts
+   out empty, including the cost of growing it. */
+void
+test_bench_hash (void)
+{
+  size_t s;
+
+  random_init (0);
+  for (s = 0; s < CONTAINER_SIZE_CNT; s++)
+    {
+      int cnt = container_sizes[s];
+      struct bench_elem *elems = make_elems (cnt);
+      struct hash hash;
+      uint64_t start;
+      char key[32];
+      int i;
+
+      if (!hash_init (&hash, hash_key, hash_key_less, NULL))
+        fail ("out of memory");
+
+      start = rdtsc ();
+      for (i = 0; i < cnt; i++)
+        hash_insert (&hash, &elems[i].hash_elem);
+      snprintf (key, sizeof key, "hash-insert-%d", cnt);
+      bench_report (key, rdtsc () - start, cnt);
+
+      hash_destroy (&hash, NULL);
+      free (elems);
+    }
+}
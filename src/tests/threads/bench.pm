@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks that the benchmark ran to completion and reported a
+# result for each of the KEYS.
+sub check_bench {
+    my (@keys) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (%seen);
+    foreach (@output) {
+	$seen{$1} = 1 if /^\(bench-[a-z]+\) BENCH (\S+) \d+ cycles\/op$/;
+    }
+    foreach my $key (@keys) {
+	fail "missing result for $key\n" if !$seen{$key};
+    }
+    fail "missing end of test\n"
+      if !grep (/^\(bench-[a-z]+\) end$/, @output);
+    pass;
+}
+
+1;
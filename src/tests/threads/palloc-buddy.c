@@ -0,0 +1,78 @@
+/* Allocates blocks of assorted sizes from the kernel pool, checks
+   that none of them overlap, and frees them in a scrambled order.
+   Afterward, the buddy allocator should have merged the freed
+   pages back together, so that the largest block that could be
+   allocated beforehand can be allocated again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 32            /* Number of blocks to allocate. */
+#define MAX_ORDER 10            /* Largest block to look for. */
+
+static size_t largest_block (void);
+
+void
+test_palloc_buddy (void)
+{
+  static const size_t sizes[] = {1, 3, 2, 5, 1, 8, 4, 7};
+  uint8_t *blocks[BLOCK_CNT];
+  size_t cnts[BLOCK_CNT];
+  size_t largest;
+  int i, j;
+
+  largest = largest_block ();
+  if (largest == 0)
+    fail ("could not allocate even a single page");
+
+  msg ("allocating %d blocks", BLOCK_CNT);
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      cnts[i] = sizes[i % (sizeof sizes / sizeof *sizes)];
+      blocks[i] = palloc_get_multiple (0, cnts[i]);
+      if (blocks[i] == NULL)
+        fail ("allocating block %d of %zu pages failed", i, cnts[i]);
+      memset (blocks[i], i, cnts[i] * PGSIZE);
+    }
+
+  msg ("checking contents");
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < (int) (cnts[i] * PGSIZE); j++)
+      if (blocks[i][j] != i)
+        fail ("block %d overwritten at byte %d", i, j);
+
+  msg ("freeing blocks");
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      int k = (i * 7) % BLOCK_CNT;
+      palloc_free_multiple (blocks[k], cnts[k]);
+    }
+
+  if (largest_block () < largest)
+    fail ("freed pages were not merged");
+  msg ("freed pages were merged");
+}
+
+/* Returns the number of pages in the largest power-of-two block,
+   up to 2**MAX_ORDER pages, that can be allocated from the kernel
+   pool, or 0 if not even one page can be. */
+static size_t
+largest_block (void)
+{
+  int order;
+
+  for (order = MAX_ORDER; order >= 0; order--)
+    {
+      void *block = palloc_get_multiple (0, (size_t) 1 << order);
+      if (block != NULL)
+        {
+          palloc_free_multiple (block, (size_t) 1 << order);
+          return (size_t) 1 << order;
+        }
+    }
+  return 0;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) allocating 32 blocks
+(palloc-buddy) checking contents
+(palloc-buddy) freeing blocks
+(palloc-buddy) freed pages were merged
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,88 @@
+/* Allocates kernel pages one at a time until none are left,
+   which should take more pages than the kernel pool started out
+   with, by borrowing chunks from the user pool.  The user pool
+   should still have pages left afterward, since it only lends
+   pages it can spare.  Freeing the kernel pages should give the
+   borrowed chunks back, and the same number of pages should then
+   be allocatable again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+
+static size_t exhaust (enum palloc_flags, void **pages);
+static void release (void *pages);
+
+void
+test_palloc_rebalance (void)
+{
+  void *kernel_pages, *user_page;
+  size_t first_cnt, second_cnt;
+
+  msg ("allocating all kernel pages");
+  first_cnt = exhaust (0, &kernel_pages);
+  if (first_cnt <= palloc_boot_pages (0))
+    fail ("allocated %zu kernel pages, no more than the %zu the kernel "
+          "pool started with", first_cnt, palloc_boot_pages (0));
+  if (palloc_borrowed_chunks (0) <= 0)
+    fail ("kernel pool borrowed no chunks");
+  msg ("kernel pool borrowed from user pool");
+
+  user_page = palloc_get_page (PAL_USER);
+  if (user_page == NULL)
+    fail ("user pool was drained after allocating %zu kernel pages",
+          first_cnt);
+  msg ("user pool kept free pages");
+  palloc_free_page (user_page);
+
+  msg ("freeing kernel pages");
+  release (kernel_pages);
+  if (palloc_borrowed_chunks (0) != 0
+      || palloc_borrowed_chunks (PAL_USER) != 0)
+    fail ("kernel pool kept %ld borrowed chunks, user pool %ld",
+          palloc_borrowed_chunks (0), palloc_borrowed_chunks (PAL_USER));
+  msg ("borrowed chunks given back");
+
+  msg ("allocating all kernel pages again");
+  second_cnt = exhaust (0, &kernel_pages);
+  if (second_cnt != first_cnt)
+    fail ("allocated %zu kernel pages the first time, %zu the second",
+          first_cnt, second_cnt);
+  release (kernel_pages);
+  if (palloc_borrowed_chunks (0) != 0)
+    fail ("kernel pool kept %ld borrowed chunks",
+          palloc_borrowed_chunks (0));
+  msg ("same number of pages allocated both times");
+}
+
+/* Allocates pages with FLAGS until none are left, linking them
+   through their first words into a list stored in *PAGES.
+   Returns the number of pages allocated. */
+static size_t
+exhaust (enum palloc_flags flags, void **pages)
+{
+  size_t cnt = 0;
+  void *page;
+
+  *pages = NULL;
+  while ((page = palloc_get_page (flags)) != NULL)
+    {
+      *(void **) page = *pages;
+      *pages = page;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Frees the list of PAGES built by exhaust(). */
+static void
+release (void *pages)
+{
+  while (pages != NULL)
+    {
+      void *next = *(void **) pages;
+      palloc_free_page (pages);
+      pages = next;
+    }
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-rebalance) begin
+(palloc-rebalance) allocating all kernel pages
+(palloc-rebalance) kernel pool borrowed from user pool
+(palloc-rebalance) user pool kept free pages
+(palloc-rebalance) freeing kernel pages
+(palloc-rebalance) borrowed chunks given back
+(palloc-rebalance) allocating all kernel pages again
+(palloc-rebalance) same number of pages allocated both times
+(palloc-rebalance) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Dirties some kernel pages and frees them, then sleeps so that
+   the idle thread can fill the kernel pool's reserve of
+   pre-zeroed pages.  Allocates pages with PAL_ZERO and checks
+   that every byte of each is zero, and that at least some of
+   them came from the reserve. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 16             /* Number of pages to allocate. */
+
+void
+test_palloc_zero (void)
+{
+  uint8_t *pages[PAGE_CNT];
+  unsigned long long hits;
+  int i;
+
+  msg ("dirtying %d pages", PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("allocating page %d failed", i);
+      memset (pages[i], 0x5a, PGSIZE);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  msg ("sleeping while the idle thread zeroes pages");
+  timer_sleep (10);
+
+  hits = palloc_zero_hits (0);
+  msg ("allocating %d zeroed pages", PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      size_t ofs;
+
+      pages[i] = palloc_get_page (PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("allocating zeroed page %d failed", i);
+      for (ofs = 0; ofs < PGSIZE; ofs++)
+        if (pages[i][ofs] != 0)
+          fail ("page %d has byte 0x%02x at offset %zu",
+                i, pages[i][ofs], ofs);
+    }
+  msg ("all pages are zeroed");
+
+  if (palloc_zero_hits (0) == hits)
+    fail ("no page came from the pre-zeroed reserve");
+  msg ("pre-zeroed reserve was used");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) dirtying 16 pages
+(palloc-zero) sleeping while the idle thread zeroes pages
+(palloc-zero) allocating 16 zeroed pages
+(palloc-zero) all pages are zeroed
+(palloc-zero) pre-zeroed reserve was used
+(palloc-zero) end
+EOF
+pass;
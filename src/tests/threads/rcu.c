@@ -0,0 +1,65 @@
+/* Checks that a thread is not preempted inside an RCU read-side
+   critical section, but yields as soon as it leaves it, and that
+   a callback queued with call_rcu() runs only after a quiescent
+   state. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/rcu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func sleeper_thread_func;
+static rcu_func callback;
+
+static bool sleeper_ran;
+static struct rcu_head head;
+static struct semaphore callback_done;
+
+void
+test_rcu (void)
+{
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* The sleeper wakes up while we are reading. */
+  thread_create ("sleeper", PRI_DEFAULT + 1, sleeper_thread_func, NULL);
+  rcu_read_lock ();
+  start = timer_ticks ();
+  while (timer_elapsed (start) < 5)
+    barrier ();
+  if (sleeper_ran)
+    fail ("reader preempted");
+  msg ("Reader was not preempted.");
+  rcu_read_unlock ();
+  if (!sleeper_ran)
+    fail ("reader did not yield after read-side critical section");
+  msg ("Reader yielded.");
+
+  sema_init (&callback_done, 0);
+  call_rcu (&head, callback);
+  msg ("Callback queued.");
+  sema_down (&callback_done);
+  msg ("Callback done.");
+}
+
+static void
+sleeper_thread_func (void *aux UNUSED)
+{
+  timer_sleep (2);
+  sleeper_ran = true;
+  msg ("Sleeper ran.");
+}
+
+static void
+callback (struct rcu_head *h)
+{
+  if (h != &head)
+    fail ("callback got wrong rcu_head");
+  msg ("Callback ran.");
+  sema_up (&callback_done);
+}
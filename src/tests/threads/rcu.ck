@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rcu) begin
+(rcu) Reader was not preempted.
+(rcu) Sleeper ran.
+(rcu) Reader yielded.
+(rcu) Callback queued.
+(rcu) Callback ran.
+(rcu) Callback done.
+(rcu) end
+EOF
+pass;
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-deadline) begin
+(rt-deadline) Admission control rejected rt extra.
+(rt-deadline) rt 10: 40 jobs, 0 deadline misses.
+(rt-deadline) rt 20: 20 jobs, 0 deadline misses.
+(rt-deadline) rt 40: 10 jobs, 0 deadline misses.
+(rt-deadline) end
+EOF
+pass;
@@ -0,0 +1,146 @@
+/* Tests the earliest-deadline-first real-time scheduling class.
+
+   The rt-deadline test runs three periodic real-time tasks that
+   use 75% of the CPU between them, alongside four CPU-bound
+   background threads, and checks that every job meets its
+   deadline.  It also checks that admission control turns away a
+   fourth task that would take the real-time load past 95%.
+
+   The rt-overrun test runs two tasks with the same period and
+   budget, one of which needs more CPU time per job than its
+   budget allows.  Budget enforcement should make every one of
+   its jobs late, without making the other task miss any. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct rt_task 
+  {
+    const char *name;
+    int64_t period;             /* Period, in ticks. */
+    int64_t budget;             /* CPU budget per period, in ticks. */
+    int64_t work;               /* CPU time each job needs, in ticks. */
+    int jobs;                   /* Number of jobs to run. */
+    struct thread_rt_stats stats;
+  };
+
+#define BACKGROUND_CNT 4
+
+static void run_tasks (struct rt_task *, int task_cnt, bool background);
+static thread_func rt_thread;
+static thread_func background_thread;
+static void do_work (int64_t ticks);
+
+static struct semaphore done;
+static bool stop;
+
+void
+test_rt_deadline (void) 
+{
+  struct rt_task tasks[] = 
+    {
+      {"rt 10", 10, 2, 1, 40, {0, 0, 0}},
+      {"rt 20", 20, 6, 5, 20, {0, 0, 0}},
+      {"rt 40", 40, 10, 9, 10, {0, 0, 0}},
+    };
+
+  run_tasks (tasks, sizeof tasks / sizeof *tasks, true);
+}
+
+void
+test_rt_overrun (void) 
+{
+  struct rt_task tasks[] = 
+    {
+      {"rt hog", 10, 3, 5, 10, {0, 0, 0}},
+      {"rt steady", 10, 3, 2, 10, {0, 0, 0}},
+    };
+
+  run_tasks (tasks, sizeof tasks / sizeof *tasks, false);
+}
+
+static void
+run_tasks (struct rt_task *tasks, int task_cnt, bool background) 
+{
+  int i;
+
+  sema_init (&done, 0);
+  stop = false;
+
+  for (i = 0; i < task_cnt; i++) 
+    {
+      struct rt_task *task = &tasks[i];
+      tid_t tid = thread_create_rt (task->name, task->period, task->budget,
+                                    task->period, rt_thread, task);
+      if (tid == TID_ERROR)
+        fail ("%s not admitted", task->name);
+    }
+
+  if (background) 
+    {
+      if (thread_create_rt ("rt extra", 10, 3, 10, rt_thread, NULL)
+          != TID_ERROR)
+        fail ("rt extra admitted");
+      msg ("Admission control rejected rt extra.");
+
+      for (i = 0; i < BACKGROUND_CNT; i++)
+        thread_create ("background", PRI_DEFAULT, background_thread, NULL);
+    }
+
+  for (i = 0; i < task_cnt; i++)
+    sema_down (&done);
+
+  if (background) 
+    {
+      stop = true;
+      for (i = 0; i < BACKGROUND_CNT; i++)
+        sema_down (&done);
+    }
+
+  for (i = 0; i < task_cnt; i++)
+    msg ("%s: %d jobs, %d deadline misses.",
+         tasks[i].name, tasks[i].stats.jobs, tasks[i].stats.misses);
+}
+
+/* Runs the jobs of the rt_task passed as TASK_. */
+static void
+rt_thread (void *task_) 
+{
+  struct rt_task *task = task_;
+  int i;
+
+  for (i = 0; i < task->jobs; i++) 
+    {
+      do_work (task->work);
+      thread_rt_next_period ();
+    }
+  thread_rt_get_stats (&task->stats);
+  sema_up (&done);
+}
+
+/* Spins until the running real-time thread has been charged for
+   TICKS more ticks of CPU time. */
+static void
+do_work (int64_t ticks) 
+{
+  struct thread_rt_stats stats;
+  int64_t start;
+
+  thread_rt_get_stats (&stats);
+  start = stats.ticks;
+  do
+    thread_rt_get_stats (&stats);
+  while (stats.ticks - start < ticks);
+}
+
+static void
+background_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    barrier ();
+  sema_up (&done);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-overrun) begin
+(rt-overrun) rt hog: 10 jobs, 10 deadline misses.
+(rt-overrun) rt steady: 10 jobs, 0 deadline misses.
+(rt-overrun) end
+EOF
+pass;
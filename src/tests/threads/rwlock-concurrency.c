@@ -0,0 +1,119 @@
+/* Runs a mix of reader and writer threads against one
+   reader-writer lock, each sleeping while it holds the lock so
+   that the others pile up behind it.  Checks that readers share
+   the lock with each other but never with a writer, that writers
+   never share it at all, and that every thread gets to finish.
+   Reports how many readers held the lock at once. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 6
+#define WRITER_CNT 2
+#define ITER_CNT 5
+
+static struct rwlock rw;
+static struct semaphore done;
+
+/* Threads holding RW, and the most readers that did at once. */
+static int readers, writers;
+static int max_readers;
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_concurrency (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rw);
+  sema_init (&done, 0);
+
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++)
+    {
+      char name[16];
+
+      if (i % 4 == 3)
+        {
+          snprintf (name, sizeof name, "writer %d", i);
+          thread_create (name, PRI_DEFAULT, writer_thread_func, NULL);
+        }
+      else
+        {
+          snprintf (name, sizeof name, "reader %d", i);
+          thread_create (name, PRI_DEFAULT, reader_thread_func, NULL);
+        }
+    }
+
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++)
+    sema_down (&done);
+
+  msg ("%d readers and %d writers finished.", READER_CNT, WRITER_CNT);
+  if (max_readers < 2)
+    fail ("at most %d reader held the lock at once", max_readers);
+  msg ("Readers shared the lock.");
+}
+
+static void
+reader_thread_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      enum intr_level old_level;
+
+      rwlock_read_acquire (&rw);
+      old_level = intr_disable ();
+      if (writers != 0)
+        fail ("reader holds lock along with a writer");
+      if (++readers > max_readers)
+        max_readers = readers;
+      intr_set_level (old_level);
+
+      timer_sleep (2);
+
+      old_level = intr_disable ();
+      readers--;
+      intr_set_level (old_level);
+      rwlock_read_release (&rw);
+      thread_yield ();
+    }
+  sema_up (&done);
+}
+
+static void
+writer_thread_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      enum intr_level old_level;
+
+      rwlock_write_acquire (&rw);
+      old_level = intr_disable ();
+      if (readers != 0 || writers != 0)
+        fail ("writer does not hold lock exclusively");
+      writers++;
+      intr_set_level (old_level);
+
+      timer_sleep (3);
+
+      old_level = intr_disable ();
+      writers--;
+      intr_set_level (old_level);
+      rwlock_write_release (&rw);
+      thread_yield ();
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-concurrency) begin
+(rwlock-concurrency) 6 readers and 2 writers finished.
+(rwlock-concurrency) Readers shared the lock.
+(rwlock-concurrency) end
+EOF
+pass;
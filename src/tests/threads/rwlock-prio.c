@@ -0,0 +1,79 @@
+/* The main thread acquires a reader-writer lock for reading.
+   A higher-priority thread then shares it for reading, and a
+   writer of higher priority still blocks, donating its priority
+   to the main thread.  A reader of higher priority again blocks
+   behind the waiting writer, and donates to the main thread in
+   turn.  When the main thread releases the lock, the writer
+   should acquire it, inherit the waiting reader's priority, and
+   hand the lock over to the reader when it is done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func sharer_thread_func;
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_rwlock_prio (void)
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_read_acquire (&rw);
+  thread_create ("sharer", PRI_DEFAULT + 1, sharer_thread_func, &rw);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 3, reader_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+  rwlock_read_release (&rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+sharer_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  if (!rwlock_read_try_acquire (rw))
+    fail ("sharer could not acquire lock for reading");
+  if (rwlock_write_try_acquire (rw))
+    fail ("lock acquired for writing while held for reading");
+  msg ("Sharer acquired lock for reading.");
+  rwlock_read_release (rw);
+}
+
+static void
+writer_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  msg ("Writer waiting.");
+  rwlock_write_acquire (rw);
+  msg ("Writer acquired lock with priority %d.", thread_get_priority ());
+  rwlock_write_release (rw);
+  msg ("Writer done.");
+}
+
+static void
+reader_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  msg ("Reader waiting.");
+  rwlock_read_acquire (rw);
+  msg ("Reader acquired lock.");
+  rwlock_read_release (rw);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-prio) begin
+(rwlock-prio) Sharer acquired lock for reading.
+(rwlock-prio) Writer waiting.
+(rwlock-prio) Main thread should have priority 33.  Actual priority: 33.
+(rwlock-prio) Reader waiting.
+(rwlock-prio) Main thread should have priority 34.  Actual priority: 34.
+(rwlock-prio) Writer acquired lock with priority 34.
+(rwlock-prio) Reader acquired lock.
+(rwlock-prio) Writer done.
+(rwlock-prio) Main thread should have priority 31.  Actual priority: 31.
+(rwlock-prio) end
+EOF
+pass;
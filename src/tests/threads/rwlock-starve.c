@@ -0,0 +1,85 @@
+/* Runs readers that keep acquiring and releasing a
+   reader-writer lock, overlapping with each other so that the
+   lock is almost never free, against a single writer at the
+   same priority.  Checks that the writer gets the lock before
+   the readers give up, that is, that the readers cannot starve
+   the writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 3
+#define ITER_MAX 1000
+
+static struct rwlock rw;
+static struct semaphore done;
+
+/* Set once the writer has held the lock. */
+static bool writer_done;
+
+/* Number of readers that ran out of iterations first. */
+static int starved_cnt;
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_starve (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rw);
+  sema_init (&done, 0);
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread_func, NULL);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer_thread_func, NULL);
+
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&done);
+
+  if (starved_cnt > 0)
+    fail ("writer did not get the lock within %d read iterations",
+          ITER_MAX);
+  msg ("Writer finished while readers were still running.");
+}
+
+static void
+reader_thread_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITER_MAX && !writer_done; i++)
+    {
+      rwlock_read_acquire (&rw);
+      thread_yield ();
+      rwlock_read_release (&rw);
+      thread_yield ();
+    }
+  if (!writer_done)
+    starved_cnt++;
+  sema_up (&done);
+}
+
+static void
+writer_thread_func (void *aux UNUSED)
+{
+  /* Let the readers get going first. */
+  timer_sleep (1);
+
+  rwlock_write_acquire (&rw);
+  writer_done = true;
+  rwlock_write_release (&rw);
+  sema_up (&done);
+}
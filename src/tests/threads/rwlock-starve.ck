@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-starve) begin
+(rwlock-starve) Writer finished while readers were still running.
+(rwlock-starve) end
+EOF
+pass;
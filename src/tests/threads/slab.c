@@ -0,0 +1,90 @@
+/* Allocates enough objects from a cache with a constructor to
+   fill several slabs, checks that they do not overlap, frees
+   them, and allocates again.  The constructor should run once
+   per object when its slab is created, not on every allocation,
+   and freed objects should come back in their constructed
+   state. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 64              /* Objects to allocate at once. */
+#define OBJ_MAGIC 0x0b1ec7ed    /* Set by constructor. */
+
+/* A test object, big enough that OBJ_CNT of them span several
+   slabs. */
+struct obj
+  {
+    unsigned magic;             /* OBJ_MAGIC if constructed. */
+    int id;                     /* Set by the test. */
+    char data[200];             /* Filler. */
+  };
+
+static int ctor_cnt;
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
+
+/* Allocates OBJ_CNT objects from C into OBJS and checks them. */
+static void
+alloc_objs (struct kmem_cache *c, struct obj *objs[])
+{
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (c);
+      if (objs[i] == NULL)
+        fail ("kmem_cache_alloc failed");
+      if (objs[i]->magic != OBJ_MAGIC)
+        fail ("object %d not constructed", i);
+      objs[i]->id = i;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->id != i)
+      fail ("object %d overwritten", i);
+}
+
+void
+test_slab (void)
+{
+  struct kmem_cache *c;
+  struct obj *objs[OBJ_CNT];
+  int first_cnt;
+  int i;
+
+  c = kmem_cache_create ("test", sizeof (struct obj), obj_ctor);
+
+  msg ("allocating %d objects", OBJ_CNT);
+  alloc_objs (c, objs);
+  if (ctor_cnt < OBJ_CNT)
+    fail ("constructor ran %d times for %d objects", ctor_cnt, OBJ_CNT);
+  first_cnt = ctor_cnt;
+
+  msg ("freeing them");
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (c, objs[i]);
+
+  msg ("allocating one object again");
+  objs[0] = kmem_cache_alloc (c);
+  if (objs[0] == NULL)
+    fail ("kmem_cache_alloc failed");
+  if (objs[0]->magic != OBJ_MAGIC)
+    fail ("object lost its constructed state");
+  if (ctor_cnt != first_cnt)
+    fail ("constructor ran again for a reused object");
+  kmem_cache_free (c, objs[0]);
+
+  msg ("allocating %d objects again", OBJ_CNT);
+  alloc_objs (c, objs);
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (c, objs[i]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) allocating 64 objects
+(slab) freeing them
+(slab) allocating one object again
+(slab) allocating 64 objects again
+(slab) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* Checks the per-CPU data and spinlocks.  A spinlock must turn
+   interrupts off while it is held and restore them only when the
+   last spinlock held is released, whatever the order, and
+   spinlock_try_acquire() must fail on a held spinlock.  Each
+   thread must see the CPU it runs on, and the idle thread's
+   ticks must be charged to that CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct spinlock a, b;
+
+/* CPU that the child thread ran on. */
+static struct cpu *child_cpu;
+static struct semaphore done;
+
+static thread_func cpu_thread_func;
+
+void
+test_spinlock (void)
+{
+  long long idle_ticks;
+
+  spinlock_init (&a, "a");
+  spinlock_init (&b, "b");
+
+  msg ("acquiring two spinlocks");
+  ASSERT (intr_get_level () == INTR_ON);
+  spinlock_acquire (&a);
+  if (intr_get_level () != INTR_OFF)
+    fail ("interrupts on while holding a spinlock");
+  spinlock_acquire (&b);
+  if (!spinlock_held (&a) || !spinlock_held (&b))
+    fail ("spinlock_held() false for a held spinlock");
+  if (spinlock_try_acquire (&a))
+    fail ("spinlock_try_acquire() succeeded on a held spinlock");
+
+  msg ("releasing them out of order");
+  spinlock_release (&a);
+  if (spinlock_held (&a))
+    fail ("spinlock_held() true for a released spinlock");
+  if (intr_get_level () != INTR_OFF)
+    fail ("interrupts on while still holding a spinlock");
+  spinlock_release (&b);
+  if (intr_get_level () != INTR_ON)
+    fail ("interrupts still off after releasing every spinlock");
+
+  if (!spinlock_try_acquire (&a))
+    fail ("spinlock_try_acquire() failed on a free spinlock");
+  spinlock_release (&a);
+  msg ("interrupts restored");
+
+  if (cpu_cnt < 1 || cpu_current ()->id >= cpu_cnt)
+    fail ("running on CPU %u of %u", cpu_current ()->id, cpu_cnt);
+  sema_init (&done, 0);
+  thread_create ("child", PRI_DEFAULT, cpu_thread_func, NULL);
+  sema_down (&done);
+  if (cpu_cnt == 1 && child_cpu != cpu_current ())
+    fail ("child thread ran on a different CPU");
+  msg ("threads see their CPU");
+
+  idle_ticks = cpu_current ()->idle_ticks;
+  timer_sleep (5);
+  if (cpu_current ()->idle_ticks <= idle_ticks)
+    fail ("no idle ticks charged to this CPU while sleeping");
+  msg ("idle ticks charged to this CPU");
+}
+
+static void
+cpu_thread_func (void *aux UNUSED)
+{
+  child_cpu = cpu_current ();
+  sema_up (&done);
+}
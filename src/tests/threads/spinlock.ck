@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spinlock) begin
+(spinlock) acquiring two spinlocks
+(spinlock) releasing them out of order
+(spinlock) interrupts restored
+(spinlock) threads see their CPU
+(spinlock) idle ticks charged to this CPU
+(spinlock) end
+EOF
+pass;
@@ -0,0 +1,79 @@
+/* Checks that the stride scheduler divides the CPU among many
+   threads in proportion to their tickets.
+
+   Runs 60 CPU-bound threads, with 100, 200, 300 and 400 tickets
+   in turn, for 30 seconds.  The 15,000 tickets in all share about
+   30 * 100 == 3000 ticks, so each thread should receive about one
+   tick per 5 tickets: 20, 40, 60 and 80 ticks respectively.
+
+   Modelled on the mlfqs-fair tests. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 60
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int tick_count;
+    int tickets;
+  };
+
+static void load_thread (void *aux);
+
+void
+test_stride_fair (void) 
+{
+  struct thread_info info[THREAD_CNT];
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_stride);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->tickets = 100 * (i % 4 + 1);
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 40 seconds to let threads run, please wait...");
+  timer_sleep (40 * TIMER_FREQ);
+  
+  for (i = 0; i < THREAD_CNT; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_tickets (ti->tickets);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
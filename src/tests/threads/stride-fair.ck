@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::mlfqs;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@actual);
+local ($_);
+foreach (@output) {
+    my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+    $actual[$id] = $count;
+}
+
+# Thread N holds 100 * (N % 4 + 1) of 15,000 tickets, so it should
+# get that share of 3000 ticks, give or take a bit over one time
+# slice.
+my (@expected) = map (3000 * 100 * ($_ % 4 + 1) / 15000, 0...59);
+mlfqs_compare ("thread", "%d", \@actual, \@expected, 6, [0, 59, 1],
+	       "Some tick counts were missing or differed from those "
+	       . "expected by more than 6.");
+pass;
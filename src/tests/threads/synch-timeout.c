@@ -0,0 +1,115 @@
+/* Checks sema_down_timeout(), lock_acquire_timeout() and
+   cond_wait_timeout(): each should give up after its timeout if
+   nothing happens, and succeed early if woken.  A thread that
+   times out acquiring a lock must stop donating its priority to
+   the lock's holder. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMEOUT 10              /* Ticks to wait for nothing. */
+#define LONG_TIMEOUT 1000       /* Ticks to wait for something. */
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition cond;
+static struct semaphore held, go, done;
+
+static thread_func sema_up_thread;
+static thread_func lock_holder_thread;
+static thread_func cond_signal_thread;
+
+void
+test_synch_timeout (void)
+{
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+  sema_init (&held, 0);
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+
+  /* Semaphores. */
+  if (sema_down_timeout (&sema, 0))
+    fail ("sema_down_timeout with no time succeeded");
+  start = timer_ticks ();
+  if (sema_down_timeout (&sema, TIMEOUT))
+    fail ("sema_down_timeout succeeded on unsignaled semaphore");
+  if (timer_elapsed (start) < TIMEOUT)
+    fail ("sema_down_timeout gave up early");
+  msg ("sema_down_timeout timed out.");
+
+  thread_create ("sema-up", PRI_DEFAULT - 1, sema_up_thread, NULL);
+  start = timer_ticks ();
+  if (!sema_down_timeout (&sema, LONG_TIMEOUT))
+    fail ("sema_down_timeout timed out on signaled semaphore");
+  if (timer_elapsed (start) >= LONG_TIMEOUT)
+    fail ("sema_down_timeout woke late");
+  msg ("sema_down_timeout woken by sema_up.");
+
+  /* The wakeup above must have cancelled the timeout. */
+  timer_sleep (TIMEOUT);
+
+  /* Locks. */
+  thread_create ("holder", PRI_DEFAULT - 1, lock_holder_thread, NULL);
+  sema_down (&held);
+  if (lock_acquire_timeout (&lock, TIMEOUT))
+    fail ("lock_acquire_timeout acquired held lock");
+  msg ("lock_acquire_timeout timed out.");
+  sema_up (&go);
+  sema_down (&done);
+  if (!lock_acquire_timeout (&lock, TIMEOUT))
+    fail ("lock_acquire_timeout failed on free lock");
+  msg ("lock_acquire_timeout acquired free lock.");
+
+  /* Condition variables. */
+  if (cond_wait_timeout (&cond, &lock, TIMEOUT))
+    fail ("cond_wait_timeout signaled without signal");
+  msg ("cond_wait_timeout timed out.");
+
+  thread_create ("signal", PRI_DEFAULT - 1, cond_signal_thread, NULL);
+  if (!cond_wait_timeout (&cond, &lock, LONG_TIMEOUT))
+    fail ("cond_wait_timeout timed out despite signal");
+  if (!lock_held_by_current_thread (&lock))
+    fail ("cond_wait_timeout returned without lock");
+  msg ("cond_wait_timeout woken by cond_signal.");
+  lock_release (&lock);
+}
+
+static void
+sema_up_thread (void *aux UNUSED)
+{
+  sema_up (&sema);
+}
+
+static void
+lock_holder_thread (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  sema_up (&held);
+  sema_down (&go);
+  msg ("Holder should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT - 1, thread_get_priority ());
+  lock_release (&lock);
+  sema_up (&done);
+}
+
+static void
+cond_signal_thread (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  cond_signal (&cond, &lock);
+  lock_release (&lock);
+}
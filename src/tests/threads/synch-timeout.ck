@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(synch-timeout) begin
+(synch-timeout) sema_down_timeout timed out.
+(synch-timeout) sema_down_timeout woken by sema_up.
+(synch-timeout) lock_acquire_timeout timed out.
+(synch-timeout) Holder should have priority 30.  Actual priority: 30.
+(synch-timeout) lock_acquire_timeout acquired free lock.
+(synch-timeout) cond_wait_timeout timed out.
+(synch-timeout) cond_wait_timeout woken by cond_signal.
+(synch-timeout) end
+EOF
+pass;
@@ -17,6 +17,14 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"bench-switch", test_bench_switch},
+    {"bench-lock", test_bench_lock},
+    {"bench-thread", test_bench_thread},
+    {"bench-malloc", test_bench_malloc},
+    {"bench-palloc", test_bench_palloc},
+    {"bench-sleep", test_bench_sleep},
+    {"bench-list", test_bench_list},
+    {"bench-hash", test_bench_hash},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -38,6 +46,20 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-rebalance", test_palloc_rebalance},
+    {"palloc-zero", test_palloc_zero},
+    {"rcu", test_rcu},
+    {"rt-deadline", test_rt_deadline},
+    {"rt-overrun", test_rt_overrun},
+    {"rwlock-concurrency", test_rwlock_concurrency},
+    {"rwlock-prio", test_rwlock_prio},
+    {"rwlock-starve", test_rwlock_starve},
+    {"slab", test_slab},
+    {"spinlock", test_spinlock},
+    {"stride-fair", test_stride_fair},
+    {"synch-timeout", test_synch_timeout},
+    {"workqueue", test_workqueue},
   };
 
 static const char *test_name;
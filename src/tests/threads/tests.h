@@ -11,6 +11,14 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_bench_switch;
+extern test_func test_bench_lock;
+extern test_func test_bench_thread;
+extern test_func test_bench_malloc;
+extern test_func test_bench_palloc;
+extern test_func test_bench_sleep;
+extern test_func test_bench_list;
+extern test_func test_bench_hash;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -32,6 +40,20 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_rebalance;
+extern test_func test_palloc_zero;
+extern test_func test_rcu;
+extern test_func test_rt_deadline;
+extern test_func test_rt_overrun;
+extern test_func test_rwlock_concurrency;
+extern test_func test_rwlock_prio;
+extern test_func test_rwlock_starve;
+extern test_func test_slab;
+extern test_func test_spinlock;
+extern test_func test_stride_fair;
+extern test_func test_synch_timeout;
+extern test_func test_workqueue;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
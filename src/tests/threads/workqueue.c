@@ -0,0 +1,60 @@
+/* Queues work items on a workqueue whose worker thread runs at
+   lower priority than the main thread, and checks that each item
+   runs once, in the order queued, as soon as the main thread
+   blocks.  Also checks that an item that is already queued is
+   not queued again, but may be once it has run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define WORK_CNT 5
+
+static work_func record_work;
+static struct work works[WORK_CNT];
+static struct semaphore done;
+
+void
+test_workqueue (void) 
+{
+  struct workqueue *wq;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  wq = workqueue_create ("worker", PRI_DEFAULT - 1);
+  ASSERT (wq != NULL);
+
+  for (i = 0; i < WORK_CNT; i++) 
+    {
+      work_init (&works[i], record_work, NULL);
+      if (!workqueue_queue (wq, &works[i]))
+        fail ("work %d not queued", i);
+    }
+  if (workqueue_queue (wq, &works[0]))
+    fail ("work 0 queued twice");
+  msg ("Queued %d work items.", WORK_CNT);
+
+  sema_down (&done);
+  msg ("Back in main thread.");
+
+  if (!workqueue_queue (wq, &works[WORK_CNT - 1]))
+    fail ("work %d not queued again", WORK_CNT - 1);
+  sema_down (&done);
+  msg ("Back in main thread.");
+}
+
+static void
+record_work (struct work *w) 
+{
+  int i = w - works;
+
+  msg ("Work %d ran.", i);
+  if (i == WORK_CNT - 1)
+    sema_up (&done);
+}
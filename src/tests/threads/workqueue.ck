@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Queued 5 work items.
+(workqueue) Work 0 ran.
+(workqueue) Work 1 ran.
+(workqueue) Work 2 ran.
+(workqueue) Work 3 ran.
+(workqueue) Work 4 ran.
+(workqueue) Back in main thread.
+(workqueue) Work 4 ran.
+(workqueue) Back in main thread.
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,22 @@
+/* Reads the lock statistics and checks that the lock that
+   serializes file system calls is among them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct lockstat ls;
+  bool found = false;
+  int i;
+
+  for (i = 0; lockstat (i, &ls); i++)
+    if (!strcmp (ls.name, "file_lock"))
+      found = true;
+  CHECK (i > 0, "read lock statistics");
+  CHECK (found, "found file_lock");
+  CHECK (!lockstat (-1, &ls), "index -1 rejected");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lockstat) begin
+(lockstat) read lock statistics
+(lockstat) found file_lock
+(lockstat) index -1 rejected
+(lockstat) end
+lockstat: exit(0)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Starts and stops the profiler around some busy work. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  volatile int sum = 0;
+  int i;
+
+  CHECK (profile (true), "start profiler");
+  for (i = 0; i < 1000000; i++)
+    sum += i;
+  CHECK (profile (false), "stop profiler");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(profile-start) begin
+(profile-start) start profiler
+(profile-start) stop profiler
+(profile-start) end
+profile-start: exit(0)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Reads back the scheduling latency histogram for the default
+   priority, at which this process has been scheduled at least
+   once, and checks that invalid priorities are rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  unsigned counts[64];
+  unsigned total = 0;
+  int bucket_cnt, i;
+
+  bucket_cnt = sched_latency (PRI_DEFAULT, counts, 64);
+  CHECK (bucket_cnt > 0 && bucket_cnt <= 64,
+         "sched_latency returned a bucket count");
+  for (i = 0; i < bucket_cnt; i++)
+    total += counts[i];
+  CHECK (total > 0, "default priority histogram is not empty");
+
+  CHECK (sched_latency (-1, counts, 64) == -1, "priority -1 rejected");
+  CHECK (sched_latency (64, counts, 64) == -1, "priority 64 rejected");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-latency) begin
+(sched-latency) sched_latency returned a bucket count
+(sched-latency) default priority histogram is not empty
+(sched-latency) priority -1 rejected
+(sched-latency) priority 64 rejected
+(sched-latency) end
+sched-latency: exit(0)
+EOF
+pass;
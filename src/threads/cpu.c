@@ -0,0 +1,42 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* The CPUs, of which the first CPU_CNT are in use.  The boot
+   CPU is cpus[0]. */
+struct cpu cpus[CPU_MAX];
+unsigned cpu_cnt;
+
+/* Sets up the per-CPU data for the boot CPU.  Called before
+   thread_init(), which puts the initial thread on it. */
+void
+cpu_init (void)
+{
+  struct cpu *c = &cpus[0];
+  uint32_t eax = 1, ebx;
+
+  /* CPUID leaf 1 reports the initial local APIC ID in bits 24
+     through 31 of EBX.  See [IA32-v2a] "CPUID". */
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx) : : "ecx", "edx");
+
+  c->id = 0;
+  c->apic_id = ebx >> 24;
+  c->spin_level = INTR_OFF;
+  cpu_cnt = 1;
+}
+
+/* Returns the CPU that the running thread is on.  The running
+   thread is found from the stack pointer, which is private to
+   each CPU, as in running_thread(). */
+struct cpu *
+cpu_current (void)
+{
+  uint32_t *esp;
+  struct thread *t;
+
+  asm ("mov %%esp, %0" : "=g" (esp));
+  t = pg_round_down (esp);
+  ASSERT (t->cpu != NULL);
+  return t->cpu;
+}
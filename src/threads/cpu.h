@@ -0,0 +1,48 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Per-CPU data.
+
+   State that belongs to a processor rather than to the kernel
+   as a whole lives in a struct cpu: the processor's idle thread,
+   the running thread's time slice, tick counters, and spinlock
+   nesting.  Only the boot processor runs so far, so there is
+   just one, but code that uses cpu_current() instead of globals
+   keeps working once application processors are started.
+
+   A thread records the CPU that it runs on in its struct thread
+   each time it is scheduled.  Since a thread only changes CPUs
+   by being scheduled, a caller that keeps interrupts off may use
+   the result of cpu_current() for as long as they stay off. */
+
+/* Most CPUs supported. */
+#define CPU_MAX 8
+
+/* A processor. */
+struct cpu
+  {
+    unsigned id;                /* Index in cpus[]. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    struct thread *idle_thread; /* Runs when nothing else is ready. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+
+    /* Owned by spinlock.c. */
+    int spin_depth;             /* Number of spinlocks held. */
+    enum intr_level spin_level; /* Interrupt level before the first. */
+
+    /* Statistics. */
+    long long idle_ticks;       /* # of timer ticks spent idle. */
+    long long kernel_ticks;     /* # of timer ticks in kernel threads. */
+    long long user_ticks;       /* # of timer ticks in user programs. */
+  };
+
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+void cpu_init (void);
+struct cpu *cpu_current (void);
+
+#endif /* threads/cpu.h */
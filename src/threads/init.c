@@ -15,13 +15,18 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -57,6 +62,12 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -trace: Record kernel events? */
+static bool trace;
+
+/* -profile: Start the profiler at boot? */
+static bool profile;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -87,6 +98,7 @@ main (void)
 
   /* Initialize ourselves as a thread so we can use locks,
      then enable console locking. */
+  cpu_init ();
   thread_init ();
   console_init ();
 
@@ -97,7 +109,12 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  kmem_init ();
   paging_init ();
+  if (trace)
+    trace_init ();
+  if (profile && !profile_start ())
+    printf ("profile: could not allocate profile buffer\n");
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -118,6 +135,7 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_init ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -257,6 +275,23 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-trace"))
+        trace = true;
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+      else if (!strcmp (name, "-profile"))
+        profile = true;
+      else if (!strcmp (name, "-profile-rate"))
+        {
+          timer_subticks = atoi (value);
+          if (timer_subticks < 1 || timer_subticks > TIMER_SUBTICKS_MAX)
+            PANIC ("-profile-rate must be between 1 and %d",
+                   TIMER_SUBTICKS_MAX);
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -265,6 +300,9 @@ parse_options (char **argv)
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
 
+  if (thread_mlfqs && thread_stride)
+    PANIC ("-mlfqs and -stride are mutually exclusive");
+
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
 
@@ -380,6 +418,12 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use proportional-share stride scheduler.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -trace             Record kernel events for `pintos --trace'.\n"
+          "  -lockstat          Measure lock contention.\n"
+          "  -profile           Start the sampling profiler at boot.\n"
+          "  -profile-rate=N    Sample N times per timer tick.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -3,11 +3,16 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/rcu.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -47,6 +52,42 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* On the way out of an external interrupt, softirqs run with
+   interrupts on (see threads/workqueue.h).  That still counts as
+   interrupt context, but other external interrupts may nest
+   inside it.  A nested interrupt leaves running softirqs and
+   yielding to the interrupt it nested in. */
+static bool in_softirq;         /* Are we running softirqs? */
+
+/* Interrupts-off latency tracking.
+
+   intr_disable() stamps the time and its caller when it turns
+   interrupts off, and intr_enable() charges the time since then
+   to that caller when it turns them back on.  The section may
+   span a thread switch, in which case it is the new thread that
+   turns interrupts back on.  Sections that interrupt handlers
+   start, by the CPU turning interrupts off on entry, or end, by
+   returning from the interrupt, are not measured.
+
+   Each code location that turns interrupts off gets a slot in a
+   small open-addressed hash table, which records its longest
+   section.  intr_print_stats() reports the worst of them. */
+#define IRQOFF_SLOTS 64         /* Slots in table, a power of 2. */
+#define IRQOFF_REPORT 10        /* Number of slots to report. */
+
+struct irqoff_slot
+  {
+    void *off_at;               /* Return address of intr_disable(). */
+    void *on_at;                /* Where longest section ended. */
+    uint64_t max;               /* Longest section, in TSC cycles. */
+    unsigned cnt;               /* Number of sections. */
+  };
+
+static struct irqoff_slot irqoff_table[IRQOFF_SLOTS];
+static unsigned irqoff_overflow; /* Sections not recorded, table full. */
+static uint64_t irqoff_tsc;     /* When interrupts went off, or 0. */
+static void *irqoff_caller;     /* Who turned them off. */
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -56,6 +97,11 @@ static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 
+/* Interrupts-off latency helpers. */
+static enum intr_level do_enable (void *caller);
+static enum intr_level do_disable (void *caller);
+static void irqoff_record (void *on_at, uint64_t cycles);
+
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
@@ -80,15 +126,38 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level)
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *caller = __builtin_return_address (0);
+
+  return level == INTR_ON ? do_enable (caller) : do_disable (caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void)
+{
+  return do_enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void)
+{
+  return do_disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+do_enable (void *caller)
 {
   enum intr_level old_level = intr_get_level ();
-  ASSERT (!intr_context ());
+  ASSERT (!in_external_intr);
+
+  if (old_level == INTR_OFF && irqoff_tsc != 0)
+    {
+      irqoff_record (caller, rdtsc () - irqoff_tsc);
+      irqoff_tsc = 0;
+    }
 
   /* Enable interrupts by setting the interrupt flag.
 
@@ -99,9 +168,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void)
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+do_disable (void *caller)
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,8 +180,78 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON)
+    {
+      irqoff_tsc = rdtsc ();
+      irqoff_caller = caller;
+    }
+
   return old_level;
 }
+
+/* Charges an interrupts-off section of CYCLES, which ended at
+   ON_AT, to the location that started it. */
+static void
+irqoff_record (void *on_at, uint64_t cycles)
+{
+  uintptr_t hash = (uintptr_t) irqoff_caller;
+  unsigned i;
+
+  for (i = 0; i < IRQOFF_SLOTS; i++)
+    {
+      struct irqoff_slot *s = &irqoff_table[(hash + i) % IRQOFF_SLOTS];
+      if (s->off_at == NULL)
+        s->off_at = irqoff_caller;
+      if (s->off_at == irqoff_caller)
+        {
+          s->cnt++;
+          if (cycles > s->max)
+            {
+              s->max = cycles;
+              s->on_at = on_at;
+            }
+          return;
+        }
+    }
+  irqoff_overflow++;
+}
+
+/* Prints the code locations that kept interrupts off longest,
+   in the form that utils/backtrace accepts: for each, the
+   addresses where the longest section started and ended. */
+void
+intr_print_stats (void)
+{
+  static struct irqoff_slot table[IRQOFF_SLOTS];
+  enum intr_level old_level;
+  int i;
+
+  /* Take a snapshot, since printing turns interrupts off. */
+  old_level = intr_disable ();
+  memcpy (table, irqoff_table, sizeof table);
+  intr_set_level (old_level);
+
+  printf ("Interrupts off: longest sections in TSC cycles, "
+          "with where they began and ended\n");
+  for (i = 0; i < IRQOFF_REPORT; i++)
+    {
+      struct irqoff_slot *worst = NULL;
+      int j;
+
+      for (j = 0; j < IRQOFF_SLOTS; j++)
+        if (table[j].cnt != 0 && (worst == NULL || table[j].max > worst->max))
+          worst = &table[j];
+      if (worst == NULL)
+        break;
+
+      printf ("Interrupts off: %llu cycles max over %u sections: %p %p\n",
+              worst->max, worst->cnt, worst->off_at, worst->on_at);
+      worst->cnt = 0;
+    }
+  if (irqoff_overflow != 0)
+    printf ("Interrupts off: %u sections from too many places to track\n",
+            irqoff_overflow);
+}
 
 /* Initializes the interrupt system. */
 void
@@ -206,14 +346,13 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt,
+   including the softirqs run on its return, and false at all
+   other times. */
 bool
 intr_context (void)
 {
-
-
-  return in_external_intr;
+  return in_external_intr || in_softirq;
 }
 
 /* During processing of an external interrupt, directs the
@@ -354,13 +493,25 @@ intr_handler (struct intr_frame *frame)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
   external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  TRACE (TRACE_INTR_ENTER, frame->vec_no, 0, 0);
+
+  /* If the CPU turned interrupts off on entry, that section is
+     not ours to measure, and any stamp left over from the last
+     time they went off is stale. */
+  if (frame->eflags & FLAG_IF)
+    irqoff_tsc = 0;
   if (external)
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
+      ASSERT (!in_external_intr);
 
       in_external_intr = true;
-      yield_on_return = false;
+      if (!in_softirq)
+        yield_on_return = false;
+
+      /* Any device interrupt ends a tickless idle period. */
+      if (frame->vec_no != 0x20)
+        timer_idle_interrupted ();
     }
 
   /* Invoke the interrupt's handler. */
@@ -375,6 +526,7 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  TRACE (TRACE_INTR_EXIT, frame->vec_no, 0, 0);
 
   /* Complete the processing of an external interrupt. */
   if (external)
@@ -385,8 +537,21 @@ intr_handler (struct intr_frame *frame)
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no);
 
-      if (yield_on_return)
-        thread_yield ();
+      if (!in_softirq)
+        {
+          if (softirq_pending ())
+            {
+              in_softirq = true;
+              softirq_run ();
+              in_softirq = false;
+            }
+
+          if (yield_on_return && rcu_preempt_ok ())
+            thread_yield ();
+        }
+
+      /* Returning from the interrupt turns interrupts back on. */
+      irqoff_tsc = 0;
     }
 }
 
@@ -7,6 +7,7 @@
 #include <string.h>
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,13 +33,37 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each thread keeps a "magazine" of free blocks for each
+   descriptor, so that most calls to malloc() and free() need
+   neither take the descriptor's lock nor touch its free list.
+   malloc() takes a block from the current thread's magazine,
+   first refilling it with a batch of blocks from the descriptor
+   if it is empty; free() puts a block into the magazine, first
+   draining a batch back to the descriptor if it is full.  Only
+   the thread that owns a magazine uses it, so no locking is
+   needed.
+
+   As far as its arena is concerned, a block in a magazine is
+   still in use, so a thread's magazines are drained when it
+   exits.  To keep magazines from pinning many arenas, a batch
+   holds at most MAGAZINE_BATCH_BYTES bytes and a magazine holds
+   at most two batches, so that the biggest blocks move one at a
+   time.  If the page allocator runs out, malloc() also drains
+   the current thread's magazines and tries again. */
+
+/* Most blocks moved between a magazine and its descriptor at a
+   time, and most bytes in those blocks. */
+#define MAGAZINE_BATCH 8
+#define MAGAZINE_BATCH_BYTES 1024
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    unsigned magazine_batch;    /* Blocks moved to or from a magazine. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
   };
@@ -61,11 +86,18 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASS_CNT]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Smallest block size, as a power of 2. */
+#define MIN_BLOCK_SHIFT 4
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void refill_magazine (struct desc *, struct malloc_magazine *);
+static void drain_magazine (struct desc *, struct malloc_magazine *,
+                            unsigned cnt);
+static void drain_magazines (void);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -73,15 +105,51 @@ malloc_init (void)
 {
   size_t block_size;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  for (block_size = 1 << MIN_BLOCK_SHIFT; block_size < PGSIZE / 2;
+       block_size *= 2)
     {
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+      d->magazine_batch = MAGAZINE_BATCH_BYTES / block_size;
+      if (d->magazine_batch > MAGAZINE_BATCH)
+        d->magazine_batch = MAGAZINE_BATCH;
+      ASSERT (d->magazine_batch >= 1);
       list_init (&d->free_list);
-      lock_init (&d->lock);
+      lock_init_named (&d->lock, "malloc");
     }
+  ASSERT (desc_cnt == MALLOC_CLASS_CNT);
+}
+
+/* Returns the descriptor for blocks of SIZE bytes, which must be
+   positive, or a null pointer if SIZE is too big for any. */
+static inline struct desc *
+size_to_desc (size_t size)
+{
+  size_t idx;
+
+  /* The smallest power of 2 at least SIZE is 2**(bsr(SIZE - 1)
+     + 1). */
+  if (size <= 1 << MIN_BLOCK_SHIFT)
+    return &descs[0];
+  idx = 32 - __builtin_clz (size - 1) - MIN_BLOCK_SHIFT;
+  return idx < desc_cnt ? &descs[idx] : NULL;
+}
+
+/* Returns the current thread's magazine for descriptor D. */
+static inline struct malloc_magazine *
+desc_to_magazine (struct desc *d)
+{
+  return &thread_current ()->magazines[d - descs];
+}
+
+/* Drains the current thread's magazines, returning their blocks
+   to their descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void)
+{
+  drain_magazines ();
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -90,6 +158,7 @@ void *
 malloc (size_t size) 
 {
   struct desc *d;
+  struct malloc_magazine *m;
   struct block *b;
   struct arena *a;
 
@@ -99,17 +168,21 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL)
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
-        return NULL;
+        {
+          /* Our magazines might be keeping arenas in use. */
+          drain_magazines ();
+          a = palloc_get_multiple (0, page_cnt);
+          if (a == NULL)
+            return NULL;
+        }
 
       /* Initialize the arena to indicate a big block of PAGE_CNT
          pages, and return it. */
@@ -119,37 +192,23 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Take a block from our magazine, refilling it if needed. */
+  m = desc_to_magazine (d);
+  if (m->cnt == 0)
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
+      refill_magazine (d, m);
+      if (m->cnt == 0)
         {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          /* Our magazines might be keeping arenas in use. */
+          drain_magazines ();
+          refill_magazine (d, m);
+          if (m->cnt == 0)
+            return NULL;
         }
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  b = m->blocks;
+  m->blocks = *(void **) b;
+  m->cnt--;
   return b;
 }
 
@@ -226,33 +285,20 @@ free (void *p)
       
       if (d != NULL) 
         {
-          /* It's a normal block.  We handle it here. */
+          /* It's a normal block.  Put it in our magazine, making
+             room first if needed. */
+          struct malloc_magazine *m = desc_to_magazine (d);
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
 
-          lock_release (&d->lock);
+          if (m->cnt >= 2 * d->magazine_batch)
+            drain_magazine (d, m, d->magazine_batch);
+          *(void **) b = m->blocks;
+          m->blocks = b;
+          m->cnt++;
         }
       else
         {
@@ -263,6 +309,103 @@ free (void *p)
     }
 }
 
+/* Moves up to D's batch of blocks from descriptor D into
+   magazine M, which must be empty, creating a new arena if D has
+   no free blocks.  Leaves M empty if memory is not available. */
+static void
+refill_magazine (struct desc *d, struct malloc_magazine *m)
+{
+  ASSERT (m->cnt == 0);
+
+  lock_acquire (&d->lock);
+  while (m->cnt < d->magazine_batch)
+    {
+      struct block *b;
+      struct arena *a;
+
+      /* If the free list is empty, create a new arena. */
+      if (list_empty (&d->free_list))
+        {
+          size_t i;
+
+          /* Allocate a page. */
+          a = palloc_get_page (0);
+          if (a == NULL)
+            break;
+
+          /* Initialize arena and add its blocks to the free list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_push_back (&d->free_list, &b->free_elem);
+            }
+        }
+
+      /* Move a block from the free list to the magazine. */
+      b = list_entry (list_pop_front (&d->free_list), struct block,
+                      free_elem);
+      a = block_to_arena (b);
+      a->free_cnt--;
+      *(void **) b = m->blocks;
+      m->blocks = b;
+      m->cnt++;
+    }
+  lock_release (&d->lock);
+}
+
+/* Moves CNT blocks from magazine M back to descriptor D, freeing
+   any arena that becomes entirely unused. */
+static void
+drain_magazine (struct desc *d, struct malloc_magazine *m, unsigned cnt)
+{
+  ASSERT (cnt <= m->cnt);
+
+  lock_acquire (&d->lock);
+  while (cnt-- > 0)
+    {
+      struct block *b = m->blocks;
+      struct arena *a = block_to_arena (b);
+
+      m->blocks = *(void **) b;
+      m->cnt--;
+
+      /* Add block to free list. */
+      list_push_front (&d->free_list, &b->free_elem);
+
+      /* If the arena is now entirely unused, free it. */
+      if (++a->free_cnt >= d->blocks_per_arena) 
+        {
+          size_t i;
+
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_remove (&b->free_elem);
+            }
+          palloc_free_page (a);
+        }
+    }
+  lock_release (&d->lock);
+}
+
+/* Drains all of the current thread's magazines. */
+static void
+drain_magazines (void)
+{
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct malloc_magazine *m = &thread_current ()->magazines[i];
+      if (m->cnt > 0)
+        drain_magazine (&descs[i], m, m->cnt);
+    }
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -4,7 +4,18 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Number of size classes, for blocks of 16 bytes up to 1 kB. */
+#define MALLOC_CLASS_CNT 7
+
+/* A thread's cache of free blocks of one size class. */
+struct malloc_magazine
+  {
+    void *blocks;               /* Free blocks, linked through first word. */
+    unsigned cnt;               /* Number of blocks. */
+  };
+
 void malloc_init (void);
+void malloc_thread_exit (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
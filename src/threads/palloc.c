@@ -1,14 +1,14 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +23,150 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   The split is only where the pools start out, though.  Memory
+   is handed out between the pools in chunks of CHUNK_PAGES
+   aligned pages, and a pool that runs out of memory borrows free
+   chunks from the other, as long as the lender is left with at
+   least LOW_WATER free pages.  A pool that has grown beyond its
+   starting size gives free chunks back to the other as soon as
+   it has more than HIGH_WATER free pages besides.  Chunks that
+   started out in the receiving pool are moved in preference to
+   others, so that each pool's memory tends to stay contiguous.
+   The user pool never grows beyond the user page limit.  Each page's
+   descriptor records which pool owns it, so the pool that a page
+   belongs to can still be found in constant time.
+
+   Each pool is a binary buddy allocator.  Its free pages are
+   kept as blocks of 2**K pages, for "order" K, each aligned on a
+   multiple of its size relative to the start of memory, in one
+   free list per order.  An allocation takes a block of the
+   smallest order that is big enough, splitting a larger one in
+   halves as needed, and gives back any pages beyond those asked
+   for.  Freeing a block merges it with its "buddy", the other
+   half of the block of the next order up, for as long as the
+   buddy is free too.  So allocating and freeing a power-of-two
+   number of pages takes O(log n) time in the size of the pool.
+
+   The free lists are threaded through an array of page
+   descriptors kept at the start of memory, not through the free
+   pages themselves, which are left untouched.
+
+   Pools are manipulated with interrupts off rather than under a
+   lock, because the scheduler frees the pages of dying threads
+   with interrupts off, and every operation is short.
+
+   Many pages are allocated with PAL_ZERO: thread stacks, page
+   directories, page tables, user stacks.  To take zeroing those
+   off the critical path, each pool keeps a reserve of up to
+   ZERO_MAX pre-zeroed pages, which the idle thread refills by
+   calling palloc_zero_idle(), at most ZERO_BUDGET pages each
+   time it runs.  A single-page PAL_ZERO allocation takes a page
+   from the reserve if there is one.  Pages in the reserve count
+   as allocated as far as the buddy allocator is concerned, but
+   any allocation that cannot otherwise be satisfied falls back
+   on them, so the reserve never makes an allocation fail.  The
+   idle thread leaves a pool alone while it is bigger than it
+   started out, so that pre-zeroed pages do not keep it from
+   giving chunks back. */
+
+/* Most pre-zeroed pages kept in each pool. */
+#define ZERO_MAX 32
+
+/* Most pages zeroed by each call to palloc_zero_idle(). */
+#define ZERO_BUDGET 8
+
+/* Pages are moved between pools in chunks of 2**CHUNK_ORDER
+   pages. */
+#define CHUNK_ORDER 5
+#define CHUNK_PAGES (1 << CHUNK_ORDER)
+
+/* A pool lends a chunk only if it keeps at least LOW_WATER free
+   pages.  A pool bigger than it started out gives a chunk back
+   once it has more than HIGH_WATER free pages besides. */
+#define LOW_WATER 32
+#define HIGH_WATER 64
+
+/* Number of block orders.  The largest block has 2**(ORDER_CNT -
+   1) pages. */
+#define ORDER_CNT 20
+
+/* Page descriptor. */
+struct page_info
+  {
+    struct list_elem free_elem;         /* Element in free list. */
+    uint8_t state;                      /* PAGE_* value. */
+    uint8_t owner;                      /* ID of pool that owns page. */
+  };
+
+/* Page states. */
+#define PAGE_FREE_HEAD 0x80     /* First page of free block, ORed
+                                   with its order. */
+#define PAGE_USED 0x40          /* Allocated.  Tracked only if
+                                   assertions are enabled. */
+#define PAGE_ZEROED 0x20        /* In pool's pre-zeroed reserve. */
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
-    uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    uint8_t id;                         /* Owner ID of pool's pages. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    size_t home_idx;                    /* Index of first page at start. */
+    size_t home_cnt;                    /* Number of pages at start. */
+    size_t max_cnt;                     /* Most pages pool may have. */
+    size_t free_cnt;                    /* Number of free pages. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks of each order. */
+    struct list zeroed;                 /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+
+    /* Statistics. */
+    unsigned long long alloc_cnt;       /* Successful allocations. */
+    unsigned long long fail_cnt;        /* Failed allocations. */
+    unsigned long long split_cnt;       /* Blocks split in halves. */
+    unsigned long long merge_cnt;       /* Blocks merged with buddies. */
+    unsigned long long zero_idle_cnt;   /* Pages zeroed while idle. */
+    unsigned long long zero_hit_cnt;    /* PAL_ZERO pages pre-zeroed. */
+    unsigned long long zero_sync_cnt;   /* PAL_ZERO pages zeroed on demand. */
+    unsigned long long gain_cnt;        /* Chunks gained from other pool. */
+    unsigned long long loss_cnt;        /* Chunks given to other pool. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+/* The pools, indexed by owner ID. */
+static struct pool *const pools[] = {&kernel_pool, &user_pool};
+#define POOL_CNT (sizeof pools / sizeof *pools)
+
+/* Memory shared by the pools. */
+static uint8_t *mem_base;               /* First page. */
+static size_t mem_page_cnt;             /* Number of pages. */
+static struct page_info *mem_pages;     /* Descriptor for each page. */
+
+static void init_pool (struct pool *, uint8_t id, const char *name,
+                       size_t page_idx, size_t page_cnt, size_t max_cnt);
+static struct pool *page_to_pool (void *page);
+static struct pool *other_pool (struct pool *);
+static bool borrow_chunk (struct pool *);
+static void give_back_chunks (struct pool *, size_t page_idx,
+                              size_t page_cnt);
+static bool move_chunk (struct pool *from, struct pool *to);
+static bool take_chunk (struct pool *from, struct pool *to,
+                        size_t *page_idx);
+static int order_for (size_t page_cnt);
+static void *alloc_pages (struct pool *, size_t page_cnt);
+static void *take_zeroed (struct pool *);
+static void flush_zeroed (struct pool *);
+static bool flush_zeroed_chunks (struct pool *, size_t page_idx,
+                                 size_t page_cnt);
+static bool take_block (struct pool *, int order, size_t *page_idx);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void push_free (struct pool *, size_t page_idx, int order);
+static void remove_free (struct pool *, size_t page_idx);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -49,16 +177,32 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
+  size_t info_pages, user_pages, kernel_pages;
+
+  /* We'll put the page descriptors at the start of free memory.
+     Calculate the space needed for them and subtract it from the
+     memory to be divided. */
+  info_pages = DIV_ROUND_UP (free_pages * sizeof *mem_pages, PGSIZE);
+  if (info_pages >= free_pages)
+    PANIC ("Not enough memory for page descriptors.");
+  mem_pages = (struct page_info *) free_start;
+  mem_base = free_start + info_pages * PGSIZE;
+  mem_page_cnt = free_pages - info_pages;
+  memset (mem_pages, 0, mem_page_cnt * sizeof *mem_pages);
+
+  /* Give half of memory to kernel, half to user, splitting on a
+     chunk boundary. */
+  user_pages = mem_page_cnt / 2;
   if (user_pages > user_page_limit)
     user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  kernel_pages = ROUND_UP (mem_page_cnt - user_pages, CHUNK_PAGES);
+  if (kernel_pages > mem_page_cnt)
+    kernel_pages = mem_page_cnt;
+  user_pages = mem_page_cnt - kernel_pages;
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  init_pool (&kernel_pool, 0, "kernel pool", 0, kernel_pages, SIZE_MAX);
+  init_pool (&user_pool, 1, "user pool", kernel_pages, user_pages,
+             user_page_limit);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -66,29 +210,70 @@ palloc_init (size_t user_page_limit)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.
+
+   A request for a number of pages that is not a power of two is
+   carved out of a free block of the next power of two up. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
-  size_t page_idx;
+  enum intr_level old_level;
+  void *pages = NULL;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zeroed_cnt > 0)
+    {
+      pages = take_zeroed (pool);
+      zeroed = true;
+    }
+  if (pages == NULL)
+    pages = alloc_pages (pool, page_cnt);
+  if (pages == NULL && pool->zeroed_cnt > 0)
+    {
+      /* Fall back on the pre-zeroed pages. */
+      if (page_cnt == 1)
+        {
+          pages = take_zeroed (pool);
+          zeroed = true;
+        }
+      else
+        {
+          flush_zeroed (pool);
+          pages = alloc_pages (pool, page_cnt);
+        }
+    }
+  if (pages == NULL)
+    {
+      /* Borrow chunks from the other pool, at most as many as the
+         request could need. */
+      size_t chunk_cnt = DIV_ROUND_UP (page_cnt, CHUNK_PAGES);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+      while (pages == NULL && chunk_cnt-- > 0 && borrow_chunk (pool))
+        pages = alloc_pages (pool, page_cnt);
+    }
+  if (pages != NULL)
+    {
+      pool->alloc_cnt++;
+      if (flags & PAL_ZERO)
+        {
+          if (zeroed)
+            pool->zero_hit_cnt++;
+          else
+            pool->zero_sync_cnt += page_cnt;
+        }
+    }
   else
-    pages = NULL;
+    pool->fail_cnt++;
+  intr_set_level (old_level);
 
   if (pages != NULL)
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else
@@ -118,27 +303,38 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  pool = page_to_pool (pages);
+  page_idx = pg_no (pages) - pg_no (mem_base);
+  ASSERT (page_idx + page_cnt <= mem_page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+#ifndef NDEBUG
+  {
+    size_t i;
+    for (i = 0; i < page_cnt; i++)
+      {
+        ASSERT (mem_pages[page_idx + i].state == PAGE_USED);
+        ASSERT (mem_pages[page_idx + i].owner == pool->id);
+        mem_pages[page_idx + i].state = 0;
+      }
+  }
+#endif
+  free_range (pool, page_idx, page_cnt);
+  pool->free_cnt += page_cnt;
+
+  give_back_chunks (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,35 +344,551 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Zeroes up to ZERO_BUDGET free pages and adds them to their
+   pools' reserves of pre-zeroed pages, kernel pool first.  Called
+   by the idle thread with interrupts on, so that zeroing does
+   not delay interrupts. */
+void
+palloc_zero_idle (void)
+{
+  int budget = ZERO_BUDGET;
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  for (i = 0; i < POOL_CNT; i++)
+    {
+      struct pool *pool = pools[i];
+
+      /* A pool that has grown would only have to flush these
+         pages again to give its extra chunks back. */
+      if (pool->page_cnt > pool->home_cnt)
+        continue;
+
+      while (budget > 0 && pool->zeroed_cnt < ZERO_MAX)
+        {
+          struct page_info *pi;
+          uint8_t *page;
+
+          intr_disable ();
+          page = alloc_pages (pool, 1);
+          intr_enable ();
+          if (page == NULL)
+            break;
+
+          memset (page, 0, PGSIZE);
+
+          intr_disable ();
+          pi = &mem_pages[pg_no (page) - pg_no (mem_base)];
+          pi->state = PAGE_ZEROED;
+          list_push_front (&pool->zeroed, &pi->free_elem);
+          pool->zeroed_cnt++;
+          pool->zero_idle_cnt++;
+          intr_enable ();
+          budget--;
+        }
+    }
+}
+
+/* Returns the number of pages that the user pool, if PAL_USER
+   is set in FLAGS, or otherwise the kernel pool, started out
+   with. */
+size_t
+palloc_boot_pages (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+  return pool->home_cnt;
+}
+
+/* Returns the number of chunks that the user pool, if PAL_USER is
+   set in FLAGS, or otherwise the kernel pool, has borrowed from
+   the other pool and not given back, or minus the number it has
+   lent to the other pool. */
+long
+palloc_borrowed_chunks (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+  long page_cnt;
+
+  old_level = intr_disable ();
+  page_cnt = (long) pool->page_cnt - (long) pool->home_cnt;
+  intr_set_level (old_level);
+
+  return page_cnt / CHUNK_PAGES;
+}
+
+/* Returns the number of PAL_ZERO allocations from the user
+   pool, if PAL_USER is set in FLAGS, or otherwise the kernel
+   pool, that were satisfied from its reserve of pre-zeroed
+   pages. */
+unsigned long long
+palloc_zero_hits (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+  unsigned long long hit_cnt;
+
+  old_level = intr_disable ();
+  hit_cnt = pool->zero_hit_cnt;
+  intr_set_level (old_level);
+
+  return hit_cnt;
+}
+
+/* Prints statistics about each pool's free space and how
+   fragmented it is. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
+/* Initializes pool P, with owner ID, as owning the PAGE_CNT
+   pages starting at index PAGE_IDX in memory, all of them free,
+   and never growing beyond MAX_CNT pages.  NAME is used for
+   debugging purposes. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
+init_pool (struct pool *p, uint8_t id, const char *name,
+           size_t page_idx, size_t page_cnt, size_t max_cnt)
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t i;
+  int order;
+
+  ASSERT (pools[id] == p);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->name = name;
+  p->id = id;
+  p->home_idx = page_idx;
+  p->page_cnt = p->home_cnt = page_cnt;
+  p->max_cnt = max_cnt;
+  p->free_cnt = page_cnt;
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free_lists[order]);
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  for (i = 0; i < page_cnt; i++)
+    mem_pages[page_idx + i].owner = id;
+  free_range (p, page_idx, page_cnt);
+}
+
+/* Returns the pool that PAGE was allocated from. */
+static struct pool *
+page_to_pool (void *page)
+{
+  size_t page_idx = pg_no (page) - pg_no (mem_base);
+
+  ASSERT (pg_no (page) >= pg_no (mem_base) && page_idx < mem_page_cnt);
+
+  return pools[mem_pages[page_idx].owner];
+}
+
+/* Returns the pool other than POOL. */
+static struct pool *
+other_pool (struct pool *pool)
+{
+  return pool == &kernel_pool ? &user_pool : &kernel_pool;
+}
+
+/* Moves a free chunk from the pool other than POOL to POOL, if
+   the other pool can spare one and POOL may grow.  Returns true
+   if successful, false otherwise. */
+static bool
+borrow_chunk (struct pool *pool)
+{
+  struct pool *lender = other_pool (pool);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (pool->page_cnt + CHUNK_PAGES > pool->max_cnt
+      || lender->free_cnt + lender->zeroed_cnt < LOW_WATER + CHUNK_PAGES)
+    return false;
+
+  if (move_chunk (lender, pool))
+    return true;
+
+  /* The lender's pre-zeroed pages may be keeping its free pages
+     from forming a whole chunk. */
+  flush_zeroed (lender);
+  return (lender->free_cnt >= LOW_WATER + CHUNK_PAGES
+          && move_chunk (lender, pool));
+}
+
+/* Gives free chunks of POOL back to the other pool for as long
+   as POOL is bigger than it started out and has plenty of free
+   pages.  Called just after freeing the PAGE_CNT pages starting
+   at index PAGE_IDX in POOL. */
+static void
+give_back_chunks (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (pool->page_cnt > pool->home_cnt
+         && pool->free_cnt + pool->zeroed_cnt >= HIGH_WATER + CHUNK_PAGES)
+    {
+      if (move_chunk (pool, other_pool (pool)))
+        continue;
+
+      /* Pre-zeroed pages may be all that keep the pages just
+         freed from forming a whole chunk. */
+      if (!flush_zeroed_chunks (pool, page_idx, page_cnt))
+        break;
+    }
+}
+
+/* Moves a free chunk from pool FROM to pool TO, if FROM has
+   one.  Returns true if successful, false otherwise. */
+static bool
+move_chunk (struct pool *from, struct pool *to)
+{
+  size_t page_idx;
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!take_chunk (from, to, &page_idx))
+    return false;
+
+  for (i = 0; i < CHUNK_PAGES; i++)
+    mem_pages[page_idx + i].owner = to->id;
+  from->page_cnt -= CHUNK_PAGES;
+  from->free_cnt -= CHUNK_PAGES;
+  from->loss_cnt++;
+  to->page_cnt += CHUNK_PAGES;
+  to->free_cnt += CHUNK_PAGES;
+  to->gain_cnt++;
+  free_range (to, page_idx, CHUNK_PAGES);
+  return true;
 }
 
-/* Returns true if PAGE was allocated from POOL,
-   false otherwise. */
+/* Takes a free chunk out of pool FROM, for moving to pool TO,
+   and stores the index of its first page in *PAGE_IDX.  Prefers
+   a chunk that TO started out with.  Returns true if successful,
+   false if FROM has no free chunk. */
 static bool
-page_from_pool (const struct pool *pool, void *page)
+take_chunk (struct pool *from, struct pool *to, size_t *page_idx)
+{
+  size_t home_end = to->home_idx + to->home_cnt;
+  int order;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (order = CHUNK_ORDER; order < ORDER_CNT; order++)
+    {
+      struct list *list = &from->free_lists[order];
+      struct list_elem *e;
+
+      for (e = list_begin (list); e != list_end (list); e = list_next (e))
+        {
+          size_t start = list_entry (e, struct page_info, free_elem)
+                         - mem_pages;
+          size_t end = start + ((size_t) 1 << order);
+          size_t chunk;
+
+          /* Find the first whole chunk of this block in TO's
+             starting range. */
+          chunk = ROUND_UP (start > to->home_idx ? start : to->home_idx,
+                            CHUNK_PAGES);
+          if (chunk + CHUNK_PAGES > end || chunk + CHUNK_PAGES > home_end)
+            continue;
+
+          /* Carve it out, freeing the rest of the block. */
+          remove_free (from, start);
+          free_range (from, start, chunk - start);
+          free_range (from, chunk + CHUNK_PAGES, end - chunk - CHUNK_PAGES);
+          *page_idx = chunk;
+          return true;
+        }
+    }
+
+  return take_block (from, CHUNK_ORDER, page_idx);
+}
+
+/* Returns the order of the smallest block that holds PAGE_CNT
+   pages, which must be positive. */
+static int
+order_for (size_t page_cnt)
+{
+  ASSERT (page_cnt > 0);
+
+  return page_cnt == 1 ? 0 : 32 - __builtin_clz (page_cnt - 1);
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL's free blocks
+   and returns the first one, or a null pointer if there is no
+   big enough block. */
+static void *
+alloc_pages (struct pool *pool, size_t page_cnt)
 {
-  size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  int order = order_for (page_cnt);
+  size_t block_cnt = (size_t) 1 << order;
+  size_t page_idx;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (order >= ORDER_CNT || !take_block (pool, order, &page_idx))
+    return NULL;
+
+  if (block_cnt > page_cnt)
+    free_range (pool, page_idx + page_cnt, block_cnt - page_cnt);
+  pool->free_cnt -= page_cnt;
+#ifndef NDEBUG
+  {
+    size_t i;
+    for (i = 0; i < page_cnt; i++)
+      mem_pages[page_idx + i].state = PAGE_USED;
+  }
+#endif
+  return mem_base + PGSIZE * page_idx;
+}
+
+/* Removes a page from POOL's reserve of pre-zeroed pages, which
+   must not be empty, and returns it. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  struct list_elem *e;
+  size_t page_idx;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (pool->zeroed_cnt > 0);
+
+  e = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+  page_idx = list_entry (e, struct page_info, free_elem) - mem_pages;
+#ifndef NDEBUG
+  mem_pages[page_idx].state = PAGE_USED;
+#else
+  mem_pages[page_idx].state = 0;
+#endif
+  return mem_base + PGSIZE * page_idx;
+}
+
+/* Returns all of POOL's pre-zeroed pages to its free blocks, so
+   that they can be merged into larger ones. */
+static void
+flush_zeroed (struct pool *pool)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (pool->zeroed_cnt > 0)
+    {
+      uint8_t *page = take_zeroed (pool);
+      size_t page_idx = pg_no (page) - pg_no (mem_base);
+
+      mem_pages[page_idx].state = 0;
+      free_range (pool, page_idx, 1);
+      pool->free_cnt++;
+    }
+}
+
+/* For each chunk that overlaps the PAGE_CNT pages starting at
+   index PAGE_IDX in POOL, frees the chunk's pre-zeroed pages if
+   that leaves the whole chunk free.  Returns true if any pages
+   were freed, false otherwise. */
+static bool
+flush_zeroed_chunks (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t chunk, end;
+  bool flushed = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  end = page_idx + page_cnt;
+  for (chunk = ROUND_DOWN (page_idx, CHUNK_PAGES); chunk < end;
+       chunk += CHUNK_PAGES)
+    {
+      size_t zeroed_cnt = 0;
+      size_t i;
+
+      if (chunk + CHUNK_PAGES > mem_page_cnt)
+        break;
+
+      /* Check that every page in the chunk is ours and is either
+         free or pre-zeroed.  Free blocks smaller than a chunk lie
+         wholly inside it. */
+      for (i = chunk; i < chunk + CHUNK_PAGES; )
+        {
+          struct page_info *pi = &mem_pages[i];
+
+          if (pi->owner != pool->id)
+            break;
+          else if (pi->state & PAGE_FREE_HEAD)
+            i += (size_t) 1 << (pi->state & ~PAGE_FREE_HEAD);
+          else if (pi->state == PAGE_ZEROED)
+            {
+              zeroed_cnt++;
+              i++;
+            }
+          else
+            break;
+        }
+      if (i != chunk + CHUNK_PAGES || zeroed_cnt == 0)
+        continue;
+
+      for (i = chunk; i < chunk + CHUNK_PAGES; i++)
+        if (mem_pages[i].state == PAGE_ZEROED)
+          {
+            list_remove (&mem_pages[i].free_elem);
+            pool->zeroed_cnt--;
+            mem_pages[i].state = 0;
+            free_range (pool, i, 1);
+            pool->free_cnt++;
+          }
+      flushed = true;
+    }
+  return flushed;
+}
+
+/* Takes a free block of the given ORDER out of POOL, splitting a
+   larger block if there is none, and stores the index of its
+   first page in *PAGE_IDX.  Returns true if successful, false if
+   there is no big enough block. */
+static bool
+take_block (struct pool *pool, int order, size_t *page_idx)
+{
+  struct list_elem *e;
+  size_t idx;
+  int k;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (k = order; k < ORDER_CNT; k++)
+    if (!list_empty (&pool->free_lists[k]))
+      break;
+  if (k == ORDER_CNT)
+    return false;
+
+  e = list_front (&pool->free_lists[k]);
+  idx = list_entry (e, struct page_info, free_elem) - mem_pages;
+  remove_free (pool, idx);
+
+  /* Split off and free the upper half until the block is the
+     right size. */
+  while (k > order)
+    {
+      k--;
+      push_free (pool, idx + ((size_t) 1 << k), k);
+      pool->split_cnt++;
+    }
+
+  *page_idx = idx;
+  return true;
+}
+
+/* Frees the PAGE_CNT pages starting at index PAGE_IDX in POOL,
+   as the largest aligned blocks that fit. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Frees the block of the given ORDER at index PAGE_IDX in POOL,
+   merging it with its buddy for as long as that is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (order + 1 < ORDER_CNT)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > mem_page_cnt
+          || mem_pages[buddy].state != (PAGE_FREE_HEAD | order)
+          || mem_pages[buddy].owner != pool->id)
+        break;
+
+      remove_free (pool, buddy);
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+      pool->merge_cnt++;
+    }
+  push_free (pool, page_idx, order);
+}
+
+/* Adds the block of the given ORDER at index PAGE_IDX to POOL's
+   free lists. */
+static void
+push_free (struct pool *pool, size_t page_idx, int order)
+{
+  struct page_info *pi = &mem_pages[page_idx];
+
+  ASSERT (pi->owner == pool->id);
+
+  pi->state = PAGE_FREE_HEAD | order;
+  list_push_front (&pool->free_lists[order], &pi->free_elem);
+}
+
+/* Removes the free block at index PAGE_IDX from POOL's free
+   lists. */
+static void
+remove_free (struct pool *pool, size_t page_idx)
+{
+  struct page_info *pi = &mem_pages[page_idx];
+
+  ASSERT (pi->state & PAGE_FREE_HEAD);
+  ASSERT (pi->owner == pool->id);
+
+  list_remove (&pi->free_elem);
+  pi->state = 0;
+}
+
+/* Prints statistics for POOL: its free pages, the largest free
+   block, and the fragmentation of its free space, that is, the
+   percentage of free pages outside the largest free block. */
+static void
+print_pool_stats (struct pool *pool)
+{
+  size_t largest = 0;
+  int order;
+
+  for (order = ORDER_CNT - 1; order >= 0; order--)
+    if (!list_empty (&pool->free_lists[order]))
+      {
+        largest = (size_t) 1 << order;
+        break;
+      }
 
-  return page_no >= start_page && page_no < end_page;
+  printf ("Palloc: %s: %zu of %zu pages free, largest free block %zu, "
+          "fragmentation %zu%%\n",
+          pool->name, pool->free_cnt + pool->zeroed_cnt, pool->page_cnt,
+          largest,
+          pool->free_cnt ? 100 - largest * 100 / pool->free_cnt : 0);
+  printf ("Palloc: %s: %llu allocations, %llu failed, %llu splits, "
+          "%llu merges\n",
+          pool->name, pool->alloc_cnt, pool->fail_cnt, pool->split_cnt,
+          pool->merge_cnt);
+  printf ("Palloc: %s: %zu pages, %zu at boot, %llu chunks gained, "
+          "%llu given up\n",
+          pool->name, pool->page_cnt, pool->home_cnt, pool->gain_cnt,
+          pool->loss_cnt);
+  printf ("Palloc: %s: %zu pages pre-zeroed, %llu zeroed while idle, "
+          "%llu PAL_ZERO pages pre-zeroed, %llu zeroed on demand\n",
+          pool->name, pool->zeroed_cnt, pool->zero_idle_cnt,
+          pool->zero_hit_cnt, pool->zero_sync_cnt);
+  printf ("Palloc: %s: free blocks by order:", pool->name);
+  for (order = 0; order < ORDER_CNT; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      printf (" %d:%zu", order,
+              list_size (&pool->free_lists[order]));
+  printf ("\n");
 }
@@ -16,5 +16,10 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_zero_idle (void);
+size_t palloc_boot_pages (enum palloc_flags);
+long palloc_borrowed_chunks (enum palloc_flags);
+unsigned long long palloc_zero_hits (enum palloc_flags);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
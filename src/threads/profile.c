@@ -0,0 +1,173 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/pagedir.h"
+#endif
+#ifdef FILESYS
+#include "filesys/fsutil.h"
+#endif
+
+/* Number of pages in the profile buffer, which holds a struct
+   profile_header, PROFILE_TASKS task entries, and as many
+   samples as fit. */
+#define PROFILE_PAGES 64
+
+/* True while timer interrupts are being sampled. */
+bool profile_enabled;
+
+/* Profile buffer, allocated by the first profile_start(). */
+static struct profile_header *prof_hdr;
+static struct profile_task *prof_tasks;
+static struct profile_sample *prof_samples;
+static size_t prof_capacity;    /* Number of samples that fit. */
+
+static uint32_t frame_caller (const struct intr_frame *);
+static void note_task (struct thread *);
+
+/* Starts profiling, allocating the profile buffer the first
+   time.  Returns true if successful, false if memory is short.
+   Must be called in thread context. */
+bool
+profile_start (void)
+{
+  ASSERT (!intr_context ());
+
+  if (prof_hdr == NULL)
+    {
+      prof_hdr = palloc_get_multiple (PAL_ZERO, PROFILE_PAGES);
+      if (prof_hdr == NULL)
+        return false;
+      prof_tasks = (struct profile_task *) (prof_hdr + 1);
+      prof_samples = (struct profile_sample *) (prof_tasks + PROFILE_TASKS);
+      prof_capacity = ((PROFILE_PAGES * PGSIZE
+                        - ((uint8_t *) prof_samples - (uint8_t *) prof_hdr))
+                       / sizeof *prof_samples);
+    }
+  profile_enabled = true;
+  return true;
+}
+
+/* Stops profiling.  The samples taken so far are kept. */
+void
+profile_stop (void)
+{
+  profile_enabled = false;
+}
+
+/* Records a sample of the code that timer interrupt frame F
+   interrupted.  Called from the timer interrupt handler. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct profile_sample *s;
+  struct thread *t = thread_current ();
+  bool user = (f->cs & 3) != 0;
+
+  ASSERT (intr_context ());
+
+  if (prof_hdr->sample_cnt >= prof_capacity)
+    {
+      prof_hdr->dropped++;
+      return;
+    }
+  if (user)
+    note_task (t);
+
+  s = &prof_samples[prof_hdr->sample_cnt++];
+  s->eip = (uint32_t) f->eip;
+  s->caller = frame_caller (f);
+  s->tid = t->tid;
+  s->flags = user ? PROFILE_USER : 0;
+}
+
+/* Returns the return address saved in the stack frame of the
+   function that F interrupted, or 0 if it cannot be found
+   safely.  The address is only as good as the frame pointer: if
+   the interrupt arrived in a function's prologue, before it set
+   up its frame, this is its caller's caller. */
+static uint32_t
+frame_caller (const struct intr_frame *f)
+{
+  const uint32_t *ra = (const uint32_t *) (f->ebp + 4);
+
+  if (f->ebp % sizeof (uint32_t) != 0)
+    return 0;
+
+  if ((f->cs & 3) == 0)
+    {
+      /* A kernel frame must lie on this thread's stack. */
+      if (pg_round_down (ra) != pg_round_down (f))
+        return 0;
+      return *ra;
+    }
+
+#ifdef USERPROG
+  if (is_user_vaddr (ra))
+    {
+      const uint32_t *kra = pagedir_get_page (thread_current ()->pagedir, ra);
+      if (kra != NULL)
+        return *kra;
+    }
+#endif
+  return 0;
+}
+
+/* Adds T to the task table if it is not already there. */
+static void
+note_task (struct thread *t)
+{
+  uint32_t i;
+
+  for (i = 0; i < prof_hdr->task_cnt; i++)
+    if (prof_tasks[i].tid == (uint32_t) t->tid)
+      return;
+  if (prof_hdr->task_cnt < PROFILE_TASKS)
+    {
+      struct profile_task *task = &prof_tasks[prof_hdr->task_cnt++];
+      task->tid = t->tid;
+      strlcpy (task->name, t->name, sizeof task->name);
+    }
+}
+
+/* Stops profiling and writes the profile, if any, to the
+   scratch device.  Must be called in thread context with
+   interrupts on, after trace_dump().  Only kernels with a file
+   system have a scratch device. */
+void
+profile_dump (void)
+{
+  if (prof_hdr == NULL)
+    return;
+  profile_enabled = false;
+
+  memcpy (prof_hdr->magic, PROFILE_MAGIC, sizeof prof_hdr->magic);
+  prof_hdr->version = PROFILE_VERSION;
+  prof_hdr->sample_size = sizeof *prof_samples;
+  prof_hdr->hz = TIMER_FREQ * timer_subticks;
+
+#ifdef FILESYS
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    printf ("profile: cannot write profile with interrupts off\n");
+  else if (!fsutil_append_data ("profile", prof_hdr,
+                                ((uint8_t *) (prof_samples
+                                              + prof_hdr->sample_cnt)
+                                 - (uint8_t *) prof_hdr)))
+    printf ("profile: could not write profile to scratch device\n");
+#endif
+}
+
+/* Prints profiling statistics. */
+void
+profile_print_stats (void)
+{
+  if (prof_hdr != NULL)
+    printf ("Profile: %"PRIu32" samples, %"PRIu32" dropped\n",
+            prof_hdr->sample_cnt, prof_hdr->dropped);
+}
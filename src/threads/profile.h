@@ -0,0 +1,70 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Sampling CPU profiler.
+
+   While profiling is on, every timer interrupt records where the
+   CPU was: the interrupted instruction, the return address in
+   the interrupted function's stack frame, the running thread,
+   and whether it was in user mode.  The "-profile-rate" kernel
+   option makes the timer interrupt several times per tick, to
+   sample more often.  The "-profile" kernel option starts
+   profiling at boot, and the profile() system call starts and
+   stops it.
+
+   At power off, a kernel with a file system writes the samples
+   to the scratch device as a ustar member named "profile", after
+   any trace (see threads/trace.h).  "pintos --profile=FILE"
+   retrieves it, and utils/profile-report turns it into flat and
+   call-site profiles. */
+
+/* A sample. */
+struct profile_sample
+  {
+    uint32_t eip;               /* Interrupted instruction. */
+    uint32_t caller;            /* Return address in its frame, or 0. */
+    uint16_t tid;               /* Running thread. */
+    uint16_t flags;             /* PROFILE_* flags. */
+  };
+
+#define PROFILE_USER 0x1        /* Sample was taken in user mode. */
+
+/* Name of a thread that was sampled in user mode, so that its
+   samples can be matched with the program it was running. */
+struct profile_task
+  {
+    uint32_t tid;               /* Thread identifier. */
+    char name[16];              /* Thread name, null-terminated. */
+  };
+
+/* Header at the start of a profile.  PROFILE_TASKS task entries
+   follow it, of which the first TASK_CNT are valid, and then the
+   samples. */
+struct profile_header
+  {
+    char magic[8];              /* PROFILE_MAGIC, not null-terminated. */
+    uint32_t version;           /* PROFILE_VERSION. */
+    uint32_t sample_size;       /* sizeof (struct profile_sample). */
+    uint32_t sample_cnt;        /* Number of samples. */
+    uint32_t dropped;           /* Samples lost to a full buffer. */
+    uint32_t hz;                /* Samples per second while profiling. */
+    uint32_t task_cnt;          /* Number of valid task entries. */
+  };
+
+#define PROFILE_MAGIC "PINPROF"
+#define PROFILE_VERSION 1
+#define PROFILE_TASKS 64
+
+extern bool profile_enabled;
+
+bool profile_start (void);
+void profile_stop (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,155 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Depth of read-side critical section nesting.  Readers are not
+   preempted, so at most one thread at a time, plus any interrupt
+   handlers that run on top of it, can be inside one. */
+static int read_depth;
+
+/* True if preemption was put off until the outermost
+   rcu_read_unlock(). */
+static bool yield_pending;
+
+/* Number of quiescent states so far. */
+static unsigned quiescent_seq;
+
+/* Callbacks waiting for a quiescent state, in the order queued. */
+static struct list callbacks = LIST_INITIALIZER (callbacks);
+
+/* Runs ready callbacks on the system workqueue. */
+static work_func run_callbacks;
+static struct work callback_work = { .func = run_callbacks };
+
+/* Enters a read-side critical section.  Read-side critical
+   sections may nest.  May be called from an interrupt handler. */
+void
+rcu_read_lock (void)
+{
+  read_depth++;
+  barrier ();
+}
+
+/* Leaves a read-side critical section.  If this ends the
+   outermost one and an interrupt asked to preempt the thread in
+   the meantime, yields now. */
+void
+rcu_read_unlock (void)
+{
+  ASSERT (read_depth > 0);
+
+  barrier ();
+  if (--read_depth == 0 && yield_pending && !intr_context ())
+    {
+      yield_pending = false;
+      thread_yield ();
+    }
+}
+
+/* Returns true if the CPU is inside a read-side critical
+   section. */
+bool
+rcu_read_lock_held (void)
+{
+  return read_depth > 0;
+}
+
+/* Called by the interrupt handler before it preempts the running
+   thread.  Returns true if the thread may be preempted.  If it is
+   inside a read-side critical section, returns false and arranges
+   for rcu_read_unlock() to yield instead. */
+bool
+rcu_preempt_ok (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (read_depth == 0)
+    return true;
+  yield_pending = true;
+  return false;
+}
+
+/* Called by the scheduler on each call to schedule(), which is a
+   quiescent state. */
+void
+rcu_quiescent (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (read_depth == 0);
+
+  quiescent_seq++;
+}
+
+/* Arranges for FUNC to be called with HEAD, in thread context on
+   the system workqueue, after every read-side critical section
+   that is in progress now has ended.  Typically HEAD is embedded
+   in an object that has just been unlinked from an RCU-protected
+   structure and FUNC frees the object.  May be called from an
+   interrupt handler. */
+void
+call_rcu (struct rcu_head *head, rcu_func *func)
+{
+  enum intr_level old_level;
+
+  ASSERT (head != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  head->func = func;
+  head->seq = quiescent_seq;
+  list_push_back (&callbacks, &head->elem);
+  intr_set_level (old_level);
+
+  work_queue (&callback_work);
+}
+
+/* Waits until every read-side critical section that is in
+   progress now has ended.  Must not be called inside one. */
+void
+synchronize_rcu (void)
+{
+  ASSERT (!intr_context ());
+  ASSERT (read_depth == 0);
+
+  /* Yielding passes through schedule(). */
+  thread_yield ();
+}
+
+/* Runs the callbacks whose quiescent state has passed, waiting
+   for one first if need be. */
+static void
+run_callbacks (struct work *w UNUSED)
+{
+  struct list ready;
+  enum intr_level old_level;
+
+  list_init (&ready);
+
+  old_level = intr_disable ();
+  if (!list_empty (&callbacks)
+      && list_entry (list_front (&callbacks), struct rcu_head,
+                     elem)->seq == quiescent_seq)
+    {
+      /* The oldest callback was queued since the last quiescent
+         state, which can happen if our own thread queued it. */
+      intr_set_level (old_level);
+      synchronize_rcu ();
+      intr_disable ();
+    }
+  while (!list_empty (&callbacks)
+         && list_entry (list_front (&callbacks), struct rcu_head,
+                        elem)->seq != quiescent_seq)
+    list_push_back (&ready, list_pop_front (&callbacks));
+  intr_set_level (old_level);
+
+  /* Callbacks queued since are left for the run of this work
+     item that their call_rcu() queued. */
+  while (!list_empty (&ready))
+    {
+      struct rcu_head *head = list_entry (list_pop_front (&ready),
+                                          struct rcu_head, elem);
+      head->func (head);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Read-copy update.
+
+   RCU lets code that only reads a shared data structure, such as
+   a lookup in a list, run without taking any lock, while code
+   that changes the structure still serializes with other
+   updaters in the usual way.  An updater never changes anything
+   a reader might be looking at in place.  It publishes new
+   objects only once they are fully initialized.  It unlinks old
+   objects without disturbing their own links, and leaves them
+   alone until every reader that might still see them is done.
+
+   A reader brackets its accesses with rcu_read_lock() and
+   rcu_read_unlock().  A read-side critical section must not
+   sleep or yield the CPU, and it is never preempted: a
+   preemption requested by an interrupt meanwhile is put off
+   until rcu_read_unlock().  So whenever the scheduler runs, no
+   thread is inside a read-side critical section.  Each call to
+   schedule() is therefore a quiescent state.  Once one has
+   happened, every reader that could have seen an object
+   unlinked before it is done.  (With more than one CPU, each of
+   them would have to pass through the scheduler.)
+
+   An updater that has unlinked an object passes it to
+   call_rcu(), which runs a callback, typically one that frees
+   the object, on the system workqueue after the next quiescent
+   state.  Alternatively, synchronize_rcu() waits for a quiescent
+   state directly. */
+
+/* Links an object into the RCU callback queue. */
+struct rcu_head;
+typedef void rcu_func (struct rcu_head *);
+struct rcu_head
+  {
+    struct list_elem elem;      /* Element in callback queue. */
+    rcu_func *func;             /* Callback. */
+    unsigned seq;               /* Quiescent states before queuing. */
+  };
+
+/* Converts pointer to rcu_head RCU_HEAD into a pointer to the
+   structure it is embedded in, as list_entry(). */
+#define rcu_entry(RCU_HEAD, STRUCT, MEMBER)                     \
+        ((STRUCT *) ((uint8_t *) (RCU_HEAD)                     \
+                     - offsetof (STRUCT, MEMBER)))
+
+void rcu_read_lock (void);
+void rcu_read_unlock (void);
+bool rcu_read_lock_held (void);
+bool rcu_preempt_ok (void);
+void rcu_quiescent (void);
+
+void call_rcu (struct rcu_head *, rcu_func *);
+void synchronize_rcu (void);
+
+/* Stores VALUE into pointer P, publishing the object it points
+   to: the stores that initialized the object are not moved past
+   the store to P. */
+#define rcu_assign_pointer(P, VALUE)            \
+        do                                      \
+          {                                     \
+            barrier ();                         \
+            (P) = (VALUE);                      \
+          }                                     \
+        while (0)
+
+/* Reads pointer P once, for use within a read-side critical
+   section. */
+#define rcu_dereference(P) (*(__typeof__ (P) volatile *) &(P))
+
+/* RCU-safe variants of list functions.  Updaters must still
+   serialize among themselves.  Readers may traverse a list
+   forward with list_begin_rcu() and list_next_rcu() while it is
+   being updated.  An element removed with list_remove_rcu() keeps
+   its links, so a reader standing on it can move on, and it must
+   not be reused or freed until a quiescent state has passed. */
+
+/* Inserts ELEM just before BEFORE, as list_insert(). */
+static inline void
+list_insert_rcu (struct list_elem *before, struct list_elem *elem)
+{
+  elem->prev = before->prev;
+  elem->next = before;
+  rcu_assign_pointer (before->prev->next, elem);
+  before->prev = elem;
+}
+
+/* Inserts ELEM at the beginning of LIST, as list_push_front(). */
+static inline void
+list_push_front_rcu (struct list *list, struct list_elem *elem)
+{
+  list_insert_rcu (list_begin (list), elem);
+}
+
+/* Inserts ELEM at the end of LIST, as list_push_back(). */
+static inline void
+list_push_back_rcu (struct list *list, struct list_elem *elem)
+{
+  list_insert_rcu (list_end (list), elem);
+}
+
+/* Removes ELEM from its list, as list_remove(), but leaves ELEM's
+   own links intact for the benefit of concurrent readers. */
+static inline void
+list_remove_rcu (struct list_elem *elem)
+{
+  rcu_assign_pointer (elem->prev->next, elem->next);
+  elem->next->prev = elem->prev;
+}
+
+/* Returns the first element of LIST, for a reader. */
+static inline struct list_elem *
+list_begin_rcu (struct list *list)
+{
+  return rcu_dereference (list->head.next);
+}
+
+/* Returns the element after ELEM, for a reader. */
+static inline struct list_elem *
+list_next_rcu (struct list_elem *elem)
+{
+  return rcu_dereference (elem->next);
+}
+
+#endif /* threads/rcu.h */
@@ -0,0 +1,343 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator, after Bonwick's.
+
+   Each slab is a single page from the page allocator, which
+   begins with a header followed by as many objects as fit.  The
+   header keeps the indexes of the slab's free objects in a
+   stack, instead of linking free objects through their own
+   memory, so that free objects keep whatever state their
+   constructor gave them.
+
+   A cache keeps its slabs on three lists: "partial" slabs, with
+   both free and allocated objects, from which allocations are
+   made first; "full" slabs, with no free objects; and "empty"
+   slabs, with no allocated objects.  A cache holds on to at most
+   SLAB_EMPTY_MAX empty slabs, so that a cache whose usage
+   bounces around a slab boundary does not keep allocating and
+   freeing pages, and returns any others to the page allocator as
+   soon as they empty.  If the page allocator runs out of pages,
+   every cache gives back its empty slabs before the allocation
+   is retried. */
+
+/* Most empty slabs that a cache keeps. */
+#define SLAB_EMPTY_MAX 1
+
+/* Objects are aligned on this many bytes. */
+#define SLAB_ALIGN 8
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* An object cache. */
+struct kmem_cache
+  {
+    struct list_elem elem;      /* Element in all_caches. */
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object, rounded up. */
+    size_t obj_cnt;             /* Number of objects per slab. */
+    size_t obj_ofs;             /* Offset of first object in slab. */
+    kmem_ctor *ctor;            /* Constructor, or null. */
+    struct lock lock;           /* Protects the rest. */
+    struct list partial;        /* Slabs with free and used objects. */
+    struct list full;           /* Slabs with no free objects. */
+    struct list empty;          /* Slabs with no used objects. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t empty_cnt;           /* Number of slabs in EMPTY. */
+    size_t used_cnt;            /* Number of allocated objects. */
+
+    /* Statistics. */
+    unsigned long long alloc_cnt;       /* Objects allocated. */
+    unsigned long long free_cnt;        /* Objects freed. */
+    unsigned long long grow_cnt;        /* Slabs created. */
+    unsigned long long reap_cnt;        /* Slabs given back. */
+  };
+
+/* A slab, at the start of its page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of cache's lists. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free_idx[];        /* Stack of free objects' indexes. */
+  };
+
+/* All caches, for kmem_reap() and kmem_print_stats(). */
+static struct list all_caches;
+static struct lock all_caches_lock;
+
+static struct slab *grow (struct kmem_cache *);
+static void release_slab (struct kmem_cache *, struct slab *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Initializes the object cache allocator. */
+void
+kmem_init (void)
+{
+  list_init (&all_caches);
+  lock_init_named (&all_caches_lock, "kmem_caches");
+}
+
+/* Creates and returns a cache of objects of SIZE bytes named
+   NAME.  If CTOR is nonnull, it is run on each object when the
+   slab that holds it is created.  Panics if memory is not
+   available, since caches are created during initialization. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor *ctor)
+{
+  struct kmem_cache *c;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("kmem_cache_create: out of memory for %s cache", name);
+
+  c->name = name;
+  c->obj_size = ROUND_UP (size, SLAB_ALIGN);
+  c->obj_cnt = ((PGSIZE - sizeof (struct slab))
+                / (c->obj_size + sizeof (uint16_t)));
+  c->obj_ofs = ROUND_UP (sizeof (struct slab)
+                         + c->obj_cnt * sizeof (uint16_t), SLAB_ALIGN);
+  if (c->obj_ofs + c->obj_cnt * c->obj_size > PGSIZE)
+    c->obj_cnt--;
+  if (c->obj_cnt == 0)
+    PANIC ("kmem_cache_create: %zu-byte %s objects do not fit in a slab",
+           size, name);
+  c->ctor = ctor;
+  lock_init_named (&c->lock, name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->slab_cnt = c->empty_cnt = c->used_cnt = 0;
+  c->alloc_cnt = c->free_cnt = c->grow_cnt = c->reap_cnt = 0;
+
+  lock_acquire (&all_caches_lock);
+  list_push_back (&all_caches, &c->elem);
+  lock_release (&all_caches_lock);
+
+  return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = grow (c);
+      if (s == NULL)
+        {
+          /* Out of pages.  Have every cache give back its empty
+             slabs, without holding our lock, and try again. */
+          lock_release (&c->lock);
+          if (kmem_reap () == 0)
+            return NULL;
+          lock_acquire (&c->lock);
+          s = grow (c);
+          if (s == NULL)
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  obj = (uint8_t *) s + c->obj_ofs + s->free_idx[--s->free_cnt] * c->obj_size;
+  if (s->free_cnt == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  c->used_cnt++;
+  c->alloc_cnt++;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+
+  ASSERT (c != NULL);
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->obj_cnt);
+  s->free_idx[s->free_cnt++] = idx;
+  if (s->free_cnt == 1 || s->free_cnt == c->obj_cnt)
+    list_remove (&s->elem);
+  if (s->free_cnt == c->obj_cnt)
+    {
+      if (c->empty_cnt < SLAB_EMPTY_MAX)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        release_slab (c, s);
+    }
+  else if (s->free_cnt == 1)
+    list_push_front (&c->partial, &s->elem);
+  c->used_cnt--;
+  c->free_cnt++;
+  lock_release (&c->lock);
+}
+
+/* Gives every cache's empty slabs back to the page allocator.
+   Returns the number of pages freed. */
+size_t
+kmem_reap (void)
+{
+  struct list_elem *e;
+  size_t page_cnt = 0;
+
+  lock_acquire (&all_caches_lock);
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      lock_acquire (&c->lock);
+      while (!list_empty (&c->empty))
+        {
+          struct slab *s = list_entry (list_pop_front (&c->empty),
+                                       struct slab, elem);
+          c->empty_cnt--;
+          release_slab (c, s);
+          page_cnt++;
+        }
+      lock_release (&c->lock);
+    }
+  lock_release (&all_caches_lock);
+
+  return page_cnt;
+}
+
+/* Prints each cache's usage. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      printf ("Slab: %s: %zu-byte objects, %zu of %zu in use, "
+              "%zu slabs (%zu partial, %zu full, %zu empty)\n",
+              c->name, c->obj_size, c->used_cnt, c->slab_cnt * c->obj_cnt,
+              c->slab_cnt, list_size (&c->partial), list_size (&c->full),
+              c->empty_cnt);
+      printf ("Slab: %s: %llu allocations, %llu frees, "
+              "%llu slabs created, %llu given back\n",
+              c->name, c->alloc_cnt, c->free_cnt, c->grow_cnt, c->reap_cnt);
+    }
+}
+
+/* Allocates a new slab for cache C, runs C's constructor on its
+   objects, and returns it, without putting it on any list.
+   Returns a null pointer if no page is available. */
+static struct slab *
+grow (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->obj_cnt;
+  for (i = 0; i < c->obj_cnt; i++)
+    {
+      /* Hand out the objects in address order. */
+      s->free_idx[i] = c->obj_cnt - i - 1;
+      if (c->ctor != NULL)
+        c->ctor ((uint8_t *) s + c->obj_ofs + i * c->obj_size);
+    }
+  c->slab_cnt++;
+  c->grow_cnt++;
+
+  return s;
+}
+
+/* Gives slab S of cache C, which has no allocated objects and is
+   on no list, back to the page allocator. */
+static void
+release_slab (struct kmem_cache *c, struct slab *s)
+{
+  ASSERT (lock_held_by_current_thread (&c->lock));
+  ASSERT (s->free_cnt == c->obj_cnt);
+
+  s->magic = 0;
+  palloc_free_page (s);
+  c->slab_cnt--;
+  c->reap_cnt++;
+}
+
+/* Returns the slab of cache C that OBJ is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
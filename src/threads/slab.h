@@ -0,0 +1,32 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of a single, exact size, carved out
+   of pages called "slabs", so that a structure that is not a
+   power of two in size does not waste the rest of a malloc()
+   block.  Each cache has its own lock, so that allocations from
+   different caches do not contend.
+
+   A cache may have a constructor, which is run on each object
+   once, when the slab that holds it is created, not on every
+   allocation.  An object with a constructor must be freed in its
+   constructed state, so that it can be handed out again as is. */
+
+struct kmem_cache;
+
+/* Initializes object OBJ of a cache. */
+typedef void kmem_ctor (void *obj);
+
+void kmem_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+size_t kmem_reap (void);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
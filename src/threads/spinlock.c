@@ -0,0 +1,116 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+static void push_intr (void);
+static void pop_intr (void);
+
+/* Atomically stores NEW into *P and returns its old value. */
+static inline uint32_t
+xchg (volatile uint32_t *p, uint32_t new)
+{
+  asm volatile ("xchgl %0, %1" : "+m" (*p), "+r" (new) : : "memory");
+  return new;
+}
+
+/* Initializes SL as an unheld spinlock.  NAME is used for
+   debugging purposes. */
+void
+spinlock_init (struct spinlock *sl, const char *name)
+{
+  ASSERT (sl != NULL);
+  ASSERT (name != NULL);
+
+  sl->locked = 0;
+  sl->cpu = NULL;
+  sl->name = name;
+}
+
+/* Acquires SL, turning interrupts off and spinning until no
+   other CPU holds it.  The current CPU must not already hold
+   it.  May be called in an interrupt handler. */
+void
+spinlock_acquire (struct spinlock *sl)
+{
+  ASSERT (sl != NULL);
+
+  push_intr ();
+  if (spinlock_held (sl))
+    PANIC ("spinlock %s acquired recursively", sl->name);
+
+  while (xchg (&sl->locked, 1) != 0)
+    while (sl->locked)
+      asm volatile ("pause");
+  sl->cpu = cpu_current ();
+}
+
+/* Tries to acquire SL without spinning.  Returns true if
+   successful, with interrupts off, or false on failure, leaving
+   the interrupt level alone. */
+bool
+spinlock_try_acquire (struct spinlock *sl)
+{
+  ASSERT (sl != NULL);
+
+  push_intr ();
+  if (xchg (&sl->locked, 1) != 0)
+    {
+      pop_intr ();
+      return false;
+    }
+  sl->cpu = cpu_current ();
+  return true;
+}
+
+/* Releases SL, which the current CPU must hold.  Turns
+   interrupts back on if they were on before the current CPU
+   acquired the first spinlock it holds. */
+void
+spinlock_release (struct spinlock *sl)
+{
+  ASSERT (sl != NULL);
+  ASSERT (spinlock_held (sl));
+
+  sl->cpu = NULL;
+  barrier ();
+  sl->locked = 0;
+  pop_intr ();
+}
+
+/* Returns true if the current CPU holds SL, false otherwise. */
+bool
+spinlock_held (const struct spinlock *sl)
+{
+  ASSERT (sl != NULL);
+
+  return (intr_get_level () == INTR_OFF && sl->locked
+          && sl->cpu == cpu_current ());
+}
+
+/* Turns interrupts off, remembering whether they were on if the
+   current CPU holds no spinlock yet. */
+static void
+push_intr (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct cpu *c = cpu_current ();
+
+  if (c->spin_depth++ == 0)
+    c->spin_level = old_level;
+}
+
+/* Undoes push_intr(), turning interrupts back on if they were on
+   before the current CPU acquired its first spinlock. */
+static void
+pop_intr (void)
+{
+  struct cpu *c = cpu_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c->spin_depth > 0);
+
+  if (--c->spin_depth == 0)
+    intr_set_level (c->spin_level);
+}
@@ -0,0 +1,39 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Spinlocks.
+
+   A spinlock protects data that interrupt handlers or the
+   scheduler also touch, where a thread cannot sleep waiting for
+   a lock.  Acquiring a spinlock turns interrupts off on the
+   current CPU, so that nothing on it can interrupt the critical
+   section, and then busy-waits for any other CPU that holds it
+   to let it go.  With a single CPU the wait never happens, and a
+   spinlock costs about as much as intr_disable().
+
+   Spinlocks nest.  The interrupt level from before the first
+   one a CPU acquired comes back when it releases the last one,
+   so they may be released in any order.  A spinlock is not
+   recursive, and the thread that holds one must not sleep or
+   yield before releasing it. */
+struct spinlock
+  {
+    volatile uint32_t locked;   /* Nonzero while held. */
+    struct cpu *cpu;            /* CPU holding it, or null. */
+    const char *name;           /* Name, for debugging. */
+  };
+
+/* Initializer for a spinlock named NAME. */
+#define SPINLOCK_INITIALIZER(NAME) { 0, NULL, NAME }
+
+void spinlock_init (struct spinlock *, const char *name);
+void spinlock_acquire (struct spinlock *);
+bool spinlock_try_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
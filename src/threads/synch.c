@@ -30,12 +30,76 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
+#include "devices/timer.h"
+
+/* Deadline of a wait that does not time out. */
+#define NO_DEADLINE INT64_MAX
+
+static heap_less_func wait_less;
+static void wait_push (struct heap *waiters);
+static struct thread *wait_pop (struct heap *waiters);
+static bool sema_down_helper (struct semaphore *sema, struct lock *lock,
+                              int64_t deadline);
+static bool lock_acquire_helper (struct lock *lock, int64_t deadline);
+static bool cond_wait_helper (struct condition *cond, struct lock *lock,
+                              int64_t ticks);
+static void sema_up_helper (struct semaphore *sema, struct lock *lock, bool yield);
+static void rwlock_wake (struct rwlock *);
+static struct lockstat *lockstat_lookup (const char *name);
+static void lockstat_acquired (struct lock *, bool contended, uint64_t start);
+static void lockstat_released (struct lock *);
+
+/* Tie breaker that keeps wait queues FIFO among threads of equal
+   priority. */
+static unsigned wait_seq;
+
+/* Orders threads in a wait queue by effective priority, highest
+   first, and then by arrival. */
+static bool
+wait_less (const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+  if (a->effective_priority != b->effective_priority)
+    return a->effective_priority > b->effective_priority;
+  return (int) (a->wait_seq - b->wait_seq) < 0;
+}
+
+/* Adds the current thread to wait queue WAITERS.  Interrupts
+   must be off.  While the thread waits, thread.c keeps its
+   position up to date as its priority changes. */
+static void
+wait_push (struct heap *waiters)
+{
+  struct thread *cur = thread_current ();
 
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cur->wait_seq = wait_seq++;
+  cur->wait_queue = waiters;
+  heap_insert (waiters, &cur->wait_elem);
+}
+
+/* Removes and returns the highest-priority thread in nonempty
+   wait queue WAITERS.  Interrupts must be off. */
+static struct thread *
+wait_pop (struct heap *waiters)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = heap_entry (heap_pop_min (waiters), struct thread, wait_elem);
+  t->wait_queue = NULL;
+  return t;
+}
 
-static bool cond_priority_less(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-static void sema_down_helper (struct semaphore *sema, struct lock *lock);
-static void sema_up_helper (struct semaphore *sema, struct lock *lock);
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -51,31 +115,60 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, wait_less, NULL);
 }
 
-static void sema_down_helper(struct semaphore *sema, struct lock *lock) {
+/* Down operation shared by sema_down(), sema_down_timeout() and
+   the lock acquire functions.  Gives up once timer_ticks()
+   reaches DEADLINE, unless DEADLINE is NO_DEADLINE.  Returns true
+   if SEMA was decremented, false if it timed out. */
+static bool
+sema_down_helper (struct semaphore *sema, struct lock *lock, int64_t deadline)
+{
   enum intr_level old_level;
+  bool success = true;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  TRACE (TRACE_SEMA_DOWN, sema, sema->value, 0);
   while (sema->value == 0)
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      /* A timed-out wait comes back around here, so that it still
+         succeeds if SEMA was upped in the meantime. */
+      if (deadline != NO_DEADLINE && timer_ticks () >= deadline)
+        {
+          success = false;
+          break;
+        }
+
+      wait_push (&sema->waiters);
 
       if (!thread_mlfqs && lock != NULL)
         thread_lock_wait_added(lock);
 
-      thread_block ();
+      if (deadline == NO_DEADLINE)
+        thread_block ();
+      else
+        thread_block_timeout (deadline - timer_ticks ());
     }
-  sema->value--;
 
-  if (lock != NULL)
-    lock->holder = thread_current ();
+  if (success)
+    {
+      sema->value--;
+
+      if (lock != NULL) {
+        lock->holder = thread_current ();
+
+        if (!thread_mlfqs)
+          thread_lock_acquired (lock);
+      }
+    }
 
   intr_set_level (old_level);
+
+  return success;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -88,7 +181,21 @@ static void sema_down_helper(struct semaphore *sema, struct lock *lock) {
 void
 sema_down (struct semaphore *sema)
 {
-  sema_down_helper (sema, NULL);
+  sema_down_helper (sema, NULL, NO_DEADLINE);
+}
+
+/* Down or "P" operation on a semaphore, but giving up after
+   TICKS timer ticks.  Returns true if SEMA was decremented, false
+   if the time ran out first.  If TICKS is zero or negative, this
+   is equivalent to sema_try_down(), except that it must not be
+   called within an interrupt handler.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  return sema_down_helper (sema, NULL, timer_ticks () + ticks);
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -124,36 +231,42 @@ sema_try_down (struct semaphore *sema)
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) {
-  sema_up_helper (sema, NULL);
+  sema_up_helper (sema, NULL, true);
 }
+
+/* Up operation shared by sema_up() and lock_release().  If YIELD
+   is true and a thread of higher priority than the current one
+   was woken, also yields the CPU, or in an interrupt handler
+   arranges to yield it on return from the interrupt. */
 static void
-sema_up_helper (struct semaphore *sema, struct lock *lock)
+sema_up_helper (struct semaphore *sema, struct lock *lock, bool yield)
 {
   enum intr_level old_level;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) {
+  TRACE (TRACE_SEMA_UP, sema, sema->value, 0);
 
-    if (!thread_mlfqs)
-      list_sort (&sema->waiters, &donation_less, NULL);
-
-    struct thread *t = list_entry (list_pop_front (&sema->waiters), struct thread, elem);
+  if (!thread_mlfqs && lock != NULL)
+    thread_lock_released (lock);
 
-    thread_unblock (t);
-
-    if (!thread_mlfqs && lock != NULL)
-      thread_lock_wait_acquired (t);
-  }
+  if (!heap_empty (&sema->waiters))
+    thread_unblock (wait_pop (&sema->waiters));
 
   sema->value++;
 
   if (lock != NULL)
     lock->holder = NULL;
 
-  if (!intr_context () && !is_highest_priority (thread_current ()))
-    thread_yield(); // the unblocked thread might have higher priority
+  /* The unblocked thread might have higher priority. */
+  if (yield && !is_highest_priority (thread_current ()))
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
 
   intr_set_level (old_level);
 
@@ -213,11 +326,24 @@ sema_test_helper (void *sema_)
    instead of a lock. */
 void
 lock_init (struct lock *lock)
+{
+  lock_init_named (lock, "(unnamed)");
+}
+
+/* Initializes LOCK as lock_init() does, and gives it NAME, under
+   which its contention statistics are reported together with
+   those of any other lock of the same name.  NAME is truncated
+   to LOCKSTAT_NAME_MAX characters. */
+void
+lock_init_named (struct lock *lock, const char *name)
 {
   ASSERT (lock != NULL);
+  ASSERT (name != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->stat = lockstat_lookup (name);
+  lock->acquired_tsc = 0;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -231,14 +357,48 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  lock_acquire_helper (lock, NO_DEADLINE);
+}
+
+/* Acquires LOCK as lock_acquire() does, but gives up after TICKS
+   timer ticks.  Returns true if successful, false if the time ran
+   out first.  While it waits, the current thread donates its
+   priority to LOCK's holder as usual; the donation is withdrawn
+   when the wait times out.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks)
+{
+  return lock_acquire_helper (lock, timer_ticks () + ticks);
+}
+
+/* Acquires LOCK, giving up once timer_ticks() reaches DEADLINE
+   unless that is NO_DEADLINE.  Returns true if successful. */
+static bool
+lock_acquire_helper (struct lock *lock, int64_t deadline)
+{
+  bool success;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down_helper (&lock->semaphore, lock);
-  lock->holder = thread_current ();
-}
+  if (lockstat_enabled)
+    {
+      uint64_t start = rdtsc ();
+      bool contended = lock->holder != NULL;
+
+      success = sema_down_helper (&lock->semaphore, lock, deadline);
+      if (success)
+        lockstat_acquired (lock, contended, start);
+    }
+  else
+    success = sema_down_helper (&lock->semaphore, lock, deadline);
 
+  return success;
+}
 
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -250,15 +410,25 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success) {
     lock->holder = thread_current ();
+
+    if (!thread_mlfqs)
+      thread_lock_acquired (lock);
   }
+  intr_set_level (old_level);
+
+  if (success && lockstat_enabled)
+    lockstat_acquired (lock, false, 0);
+
   return success;
 }
 
@@ -272,7 +442,9 @@ lock_release (struct lock *lock)
 {
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
-  sema_up_helper (&lock->semaphore, lock);
+
+  lockstat_released (lock);
+  sema_up_helper (&lock->semaphore, lock, true);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -286,13 +458,6 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-  };
-
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -301,7 +466,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, wait_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -327,36 +492,60 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock)
 {
-  struct semaphore_elem waiter;
+  cond_wait_helper (cond, lock, 0);
+}
 
-  ASSERT (cond != NULL);
-  ASSERT (lock != NULL);
-  ASSERT (!intr_context ());
-  ASSERT (lock_held_by_current_thread (lock));
+/* Waits for COND as cond_wait() does, but for at most TICKS timer
+   ticks.  Returns true if COND was signaled, false if the time
+   ran out first, in which case LOCK has still been released and
+   reacquired, so the caller must recheck its condition either
+   way.  The time taken to reacquire LOCK does not count against
+   TICKS.  If TICKS is zero or negative, returns false at once
+   without releasing LOCK.
 
-  sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
-  lock_release (lock);
-  sema_down (&waiter.semaphore);
-  lock_acquire (lock);
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks)
+{
+  return ticks > 0 && cond_wait_helper (cond, lock, ticks);
 }
 
+/* Waits for COND, for at most TICKS timer ticks if TICKS is
+   positive, otherwise indefinitely.  Returns true if COND was
+   signaled, false if the time ran out first. */
 static bool
-cond_priority_less(const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED)
+cond_wait_helper (struct condition *cond, struct lock *lock, int64_t ticks)
 {
-  struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
-  const struct thread *t_a = list_entry(list_begin(&a->semaphore.waiters), struct thread, elem);
+  enum intr_level old_level;
+  bool signaled = true;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
 
-  struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
-  const struct thread *t_b = list_entry(list_begin(&b->semaphore.waiters), struct thread, elem);
+  /* Queue ourselves and release LOCK without yielding, so that
+     no signal can slip in before we block. */
+  lockstat_released (lock);
+  old_level = intr_disable ();
+  wait_push (&cond->waiters);
+  sema_up_helper (&lock->semaphore, lock, false);
+  if (ticks > 0)
+    signaled = !thread_block_timeout (ticks);
+  else
+    thread_block ();
+  intr_set_level (old_level);
 
-  return t_a->priority > t_b->priority;
+  lock_acquire (lock);
+
+  return signaled;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the one of highest priority to wake up
+   from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -364,19 +553,21 @@ cond_priority_less(const struct list_elem *a_, const struct list_elem *b_,
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED)
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) {
-    if (!thread_mlfqs)
-      list_sort(&cond->waiters, &cond_priority_less, NULL);
-
+  old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) {
+    thread_unblock (wait_pop (&cond->waiters));
 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    if (!is_highest_priority (thread_current ()))
+      thread_yield(); // the signaled thread might have higher priority
   }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -391,7 +582,328 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
+/* Initializes RW as a reader-writer lock.  Any number of
+   threads may hold a reader-writer lock for reading at once, or
+   a single thread may hold it for writing.  Like locks,
+   reader-writer locks are not recursive, and the thread that
+   acquires one must release it.
+
+   Writers take precedence: once a writer is waiting, new readers
+   wait behind it, so that a steady stream of readers cannot
+   starve writers.  The lock stays reserved for a writer from the
+   time it is woken until it runs, so that readers that happen to
+   run first cannot take the lock out from under it.  A consequence is that a thread that holds a
+   reader-writer lock for reading must not try to acquire it for
+   reading again, because a writer may have arrived in between.
+
+   Threads waiting on a reader-writer lock donate their priority
+   to every thread holding it, in the same way as for locks. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  heap_init (&rw->read_waiters, wait_less, NULL);
+  heap_init (&rw->write_waiters, wait_less, NULL);
+  rw->writer = NULL;
+  rw->woken_writers = 0;
+  list_init (&rw->readers);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   is waiting for it.  This function may sleep, so it must not be
+   called within an interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (rw->writer != NULL || !heap_empty (&rw->write_waiters)
+         || rw->woken_writers > 0)
+    {
+      wait_push (&rw->read_waiters);
+      thread_rwlock_wait_added (rw);
+      thread_block ();
+    }
+  thread_rwlock_acquired (rw, false);
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns
+   true if successful, false on failure. */
+bool
+rwlock_read_try_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = (rw->writer == NULL && heap_empty (&rw->write_waiters)
+             && rw->woken_writers == 0);
+  if (success)
+    thread_rwlock_acquired (rw, false);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RW, which the current thread must hold for
+   reading. */
+void
+rwlock_read_release (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  thread_rwlock_released (rw);
+  if (list_empty (&rw->readers))
+    rwlock_wake (rw);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  This function may sleep, so it must not be called within
+   an interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  while (rw->writer != NULL || !list_empty (&rw->readers)
+         || rw->woken_writers > 0)
+    {
+      wait_push (&rw->write_waiters);
+      thread_rwlock_wait_added (rw);
+      thread_block ();
+
+      /* rwlock_wake() reserved the lock for us. */
+      ASSERT (rw->woken_writers > 0);
+      rw->woken_writers--;
+    }
+  thread_rwlock_acquired (rw, true);
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns
+   true if successful, false on failure. */
+bool
+rwlock_write_try_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = (rw->writer == NULL && list_empty (&rw->readers)
+             && rw->woken_writers == 0);
+  if (success)
+    thread_rwlock_acquired (rw, true);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RW, which the current thread must hold for
+   writing. */
+void
+rwlock_write_release (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->writer == thread_current ());
+
+  old_level = intr_disable ();
+  thread_rwlock_released (rw);
+  rwlock_wake (rw);
+  intr_set_level (old_level);
+}
+
+/* Wakes the threads that can acquire RW now that nobody holds
+   it: the first waiting writer if there is one, otherwise all
+   of the waiting readers.  A woken writer keeps everyone else
+   out until it runs and takes the lock.  Yields if one of the
+   woken threads should run instead of us. */
+static void
+rwlock_wake (struct rwlock *rw)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!heap_empty (&rw->write_waiters))
+    {
+      rw->woken_writers++;
+      thread_unblock (wait_pop (&rw->write_waiters));
+    }
+  else
+    while (!heap_empty (&rw->read_waiters))
+      thread_unblock (wait_pop (&rw->read_waiters));
+
+  if (!is_highest_priority (thread_current ()))
+    thread_yield ();
+}
+
+/* Lock statistics.
+
+   Every lock points to the statistics for its name, which
+   lock_init_named() finds or adds in a fixed-size table.  If
+   "-lockstat" is given on the kernel command line,
+   lock_acquire() and lock_release() time each acquisition with
+   the TSC and add to those statistics.  Otherwise, they only
+   test a flag.  lockstat_lock protects the table. */
+#define LOCKSTAT_CNT 64
+
+/* If true, measure lock acquisitions.
+   Controlled by kernel command-line option "-lockstat". */
+bool lockstat_enabled;
+
+static struct lockstat lockstats[LOCKSTAT_CNT];
+static int lockstat_cnt;
+static struct spinlock lockstat_lock = SPINLOCK_INITIALIZER ("lockstat");
+
+/* Returns the statistics for locks named NAME, adding them to
+   the table if necessary, or a null pointer if the table is
+   full. */
+static struct lockstat *
+lockstat_lookup (const char *name)
+{
+  char key[LOCKSTAT_NAME_MAX + 1];
+  struct lockstat *ls = NULL;
+  int i;
+
+  strlcpy (key, name, sizeof key);
+
+  spinlock_acquire (&lockstat_lock);
+  for (i = 0; i < lockstat_cnt; i++)
+    if (!strcmp (lockstats[i].name, key))
+      {
+        ls = &lockstats[i];
+        break;
+      }
+  if (ls == NULL && lockstat_cnt < LOCKSTAT_CNT)
+    {
+      ls = &lockstats[lockstat_cnt++];
+      strlcpy (ls->name, key, sizeof ls->name);
+    }
+  spinlock_release (&lockstat_lock);
+
+  return ls;
+}
+
+/* Accounts for the current thread's acquisition of LOCK, which
+   it started trying to acquire at START and had to wait for if
+   CONTENDED is true. */
+static void
+lockstat_acquired (struct lock *lock, bool contended, uint64_t start)
+{
+  struct lockstat *ls = lock->stat;
+  uint64_t now = rdtsc ();
+
+  lock->acquired_tsc = now;
+  if (ls == NULL)
+    return;
+
+  spinlock_acquire (&lockstat_lock);
+  ls->acquisitions++;
+  if (contended)
+    {
+      uint64_t wait = now - start;
+
+      ls->contended++;
+      ls->wait_total += wait;
+      if (wait > ls->wait_max)
+        ls->wait_max = wait;
+    }
+  spinlock_release (&lockstat_lock);
+}
+
+/* Accounts for the current thread releasing LOCK. */
+static void
+lockstat_released (struct lock *lock)
+{
+  struct lockstat *ls = lock->stat;
+  uint64_t hold;
+
+  if (lock->acquired_tsc == 0)
+    return;
+  hold = rdtsc () - lock->acquired_tsc;
+  lock->acquired_tsc = 0;
+  if (ls == NULL)
+    return;
+
+  spinlock_acquire (&lockstat_lock);
+  ls->hold_total += hold;
+  if (hold > ls->hold_max)
+    ls->hold_max = hold;
+  spinlock_release (&lockstat_lock);
+}
+
+/* Copies the statistics for the IDX'th lock name into LS.
+   Returns true if successful, false if there are not that many
+   lock names. */
+bool
+lockstat_get (int idx, struct lockstat *ls)
+{
+  if (idx < 0 || idx >= lockstat_cnt)
+    return false;
+
+  spinlock_acquire (&lockstat_lock);
+  *ls = lockstats[idx];
+  spinlock_release (&lockstat_lock);
+  return true;
+}
+
+/* Prints statistics for the most contended locks. */
+void
+lockstat_print_stats (void)
+{
+  static bool printed[LOCKSTAT_CNT];
+  int i;
+
+  if (!lockstat_enabled)
+    return;
+
+  for (i = 0; i < 10; i++)
+    {
+      struct lockstat *worst = NULL;
+      int j;
+
+      for (j = 0; j < lockstat_cnt; j++)
+        {
+          struct lockstat *ls = &lockstats[j];
+          if (!printed[j] && ls->acquisitions != 0
+              && (worst == NULL
+                  || ls->contended > worst->contended
+                  || (ls->contended == worst->contended
+                      && ls->wait_total > worst->wait_total)))
+            worst = ls;
+        }
+      if (worst == NULL)
+        break;
+      printed[worst - lockstats] = true;
+
+      printf ("Lock: %s: %u acquired, %u contended, "
+              "wait %llu/%llu cycles, hold %llu/%llu cycles (total/max)\n",
+              worst->name, worst->acquisitions, worst->contended,
+              worst->wait_total, worst->wait_max,
+              worst->hold_total, worst->hold_max);
+    }
+}
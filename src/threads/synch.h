@@ -1,18 +1,22 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
+#include <lockstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority first. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
@@ -22,25 +26,63 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's held_locks list. */
+    struct lockstat *stat;      /* Statistics for locks of this name. */
+    uint64_t acquired_tsc;      /* When acquired, if measuring, else 0. */
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock statistics. */
+extern bool lockstat_enabled;
+bool lockstat_get (int idx, struct lockstat *);
+void lockstat_print_stats (void);
+
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority first. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock
+  {
+    struct heap read_waiters;   /* Threads waiting to read. */
+    struct heap write_waiters;  /* Threads waiting to write. */
+    struct thread *writer;      /* Thread holding it to write, or null. */
+    unsigned woken_writers;     /* Writers woken but not yet running. */
+    struct list readers;        /* Holds of threads reading it. */
+  };
+
+/* A thread's hold on a reader-writer lock.  Each thread has
+   RW_HOLD_MAX of these in its struct thread. */
+struct rw_hold
+  {
+    struct list_elem elem;      /* Element in rwlock's `readers'. */
+    struct thread *thread;      /* Thread holding the lock. */
+    struct rwlock *rwlock;      /* Lock held, or null if unused. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+bool rwlock_read_try_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+bool rwlock_write_try_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
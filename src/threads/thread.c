@@ -4,15 +4,22 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/fixed-point.h"
 #include "threads/synch.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
+#include "threads/spinlock.h"
 #include "threads/switch.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -23,21 +30,74 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, kept in a multi-level
+   queue with one FIFO per priority.  Bit N of mlq_bitmap is set
+   iff mlq[N] is nonempty, so the highest-priority ready thread is
+   found with a single bsr instead of a scan or a sort.
 
-/* Ready threads in multi-level queue */
+   Without -mlfqs a thread is queued at its donated priority, with
+   -mlfqs at its computed priority. */
 static struct list mlq[MLQ_SIZE + 1];
+static uint64_t mlq_bitmap;
+
+#if MLQ_SIZE >= 64
+#error mlq_bitmap requires at most 64 priorities
+#endif
+
+/* With -stride, processes in THREAD_READY state are instead kept
+   in stride_queue, a heap ordered by pass.  The thread with the
+   smallest pass runs next, and each tick it runs advances its
+   pass by its stride, STRIDE1 / tickets, so over time each thread
+   runs in proportion to its tickets.  stride_vtime is the pass of
+   the thread dispatched most recently, which no ready thread's
+   pass is below; a thread that becomes ready starts no earlier
+   than that, so blocking does not bank CPU time. */
+#define STRIDE1 (1 << 20)
+static struct heap stride_queue;
+static int64_t stride_vtime;
+
+/* Ready real-time threads, in a heap ordered by deadline, which
+   the scheduler always drains before any other ready thread
+   (earliest deadline first).  rt_density is the sum of budget /
+   deadline over all real-time threads, which admission control
+   keeps within RT_DENSITY_MAX so that all of them can meet their
+   deadlines, with some time left over for everyone else.
+   rt_lock protects rt_density. */
+static struct heap rt_queue;
+static fixed_point_t rt_density;
+static struct spinlock rt_lock = SPINLOCK_INITIALIZER ("rt");
+#define RT_DENSITY_MAX fix_frac (95, 100)
+
+/* Real-time statistics. */
+static long long rt_jobs;       /* # of real-time jobs completed. */
+static long long rt_misses;     /* # of them that missed their deadline. */
 
 /* List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
+   when they are first scheduled and removed when they exit.
+   Updated with interrupts off, read under RCU. */
 static struct list all_list;
 
-static struct list sleep_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Sleeping threads, in a two-level hierarchical timing wheel.
+   A thread due within SLEEP_WHEEL0_SIZE ticks sits in the
+   sleep_wheel0 slot for its exact wakeup tick, a thread due
+   within SLEEP_WHEEL0_SIZE * SLEEP_WHEEL1_SIZE ticks sits in the
+   sleep_wheel1 slot for its block of SLEEP_WHEEL0_SIZE ticks, and
+   anything later waits in sleep_overflow.  Whenever sleep_wheel_tick
+   crosses into a new block the matching sleep_wheel1 slot is
+   cascaded down into sleep_wheel0, and likewise sleep_overflow
+   into sleep_wheel1 once per revolution of sleep_wheel1.  So
+   sleeping is O(1), and each tick only expires one slot, every
+   thread of which is due. */
+#define SLEEP_WHEEL0_BITS 8
+#define SLEEP_WHEEL0_SIZE (1 << SLEEP_WHEEL0_BITS)
+#define SLEEP_WHEEL1_BITS 6
+#define SLEEP_WHEEL1_SIZE (1 << SLEEP_WHEEL1_BITS)
+
+static struct list sleep_wheel0[SLEEP_WHEEL0_SIZE];
+static struct list sleep_wheel1[SLEEP_WHEEL1_SIZE];
+static struct list sleep_overflow;
+static int64_t sleep_wheel_tick; /* Last tick expired from the wheel. */
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -53,26 +113,58 @@ struct kernel_thread_frame
     void *aux;                  /* Auxiliary data for function. */
   };
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
+/* Pages of dead threads, kept for reuse by new threads so that
+   spawning a thread does not have to go to the page allocator,
+   and so clear a whole page, every time.  A recycled page is not
+   cleared at all: init_thread() and alloc_frame() clear just the
+   parts of it that a new thread relies on.  Accessed only with
+   interrupts off. */
+#define THREAD_CACHE_SIZE 16
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+static long long thread_cache_hits;   /* # of pages taken from the cache. */
+static long long thread_cache_misses; /* # of pages taken from palloc. */
+
+/* Wakeup-to-run latency histograms, one per priority, counting
+   how long threads stayed ready before they ran.  See
+   LATENCY_BUCKETS.  Accessed only with interrupts off. */
+static unsigned latency_hist[PRI_MAX + 1][LATENCY_BUCKETS];
+
+/* Under the MLFQS scheduler, a thread's priority moves around as
+   it uses the CPU, so latencies are reported for classes of this
+   many adjacent priorities instead of individual priorities. */
+#define LATENCY_CLASS_SIZE 8
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
-// the count aka the size of ready_list when mlfqs is disabled
+/* If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+// the number of threads in mlq
 static int ready_count;
 
 static fixed_point_t load_avg;
 static void update_load_avg(void);
 
+/* MLFQS recent_cpu decay is applied lazily.  Each second's decay
+   coefficient, 2*load_avg / (2*load_avg + 1), is recorded here
+   when load_avg is updated, indexed by the second modulo
+   DECAY_HISTORY, and a thread applies the coefficients it missed
+   only when it is next examined.  A thread that goes unexamined
+   for longer than DECAY_HISTORY seconds only gets the most recent
+   DECAY_HISTORY decays applied. */
+#define DECAY_HISTORY 256
+static fixed_point_t decay_coeff[DECAY_HISTORY];
+static int64_t load_avg_second; /* Last second load_avg was updated for. */
+static int64_t mlq_refresh_second; /* Last second ready queues were refreshed for. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -80,20 +172,43 @@ static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority, int nice, fixed_point_t recent_cpu);
 static bool is_thread (struct thread *) UNUSED;
+static bool is_idle_thread (const struct thread *);
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
-
-static bool sleep_less (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-static bool priority_less (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-
-static int get_max_priority_donation (struct thread *a);
-static int get_max_priority_donation_helper (struct thread *a, int depth);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static int latency_bucket (uint64_t cycles);
+static void print_latency (const char *label, const unsigned counts[]);
+
+static void sleep_insert (struct thread *t);
+static void sleep_cascade (struct list *slot);
+static void sleep_advance (int64_t now);
+static void sleep_expire (struct thread *t);
+static softirq_func sleep_softirq;
+
+static void set_effective_priority (struct thread *t, int priority);
+static void update_donation (struct thread *t);
+static int waiter_priority (const struct heap *waiters, int priority);
+static void rwlock_donate (struct rwlock *);
+static struct rw_hold *find_rw_hold (struct thread *, struct rwlock *);
 static void add_to_ready_list(struct thread *t);
-
-static void update_priority(struct thread *t, void *aux UNUSED);
-static void update_recent_cpu(struct thread *t, void *aux UNUSED);
+static void remove_from_ready_list(struct thread *t);
+static int mlq_highest_priority (void);
+static heap_less_func stride_less;
+static heap_less_func rt_less;
+static int64_t rt_current_deadline (const struct thread *t);
+static bool need_resched (struct thread *t);
+static void rt_wait_until (struct thread *t, int64_t release);
+static struct thread *thread_alloc (const char *name, struct process *,
+                                    int priority, thread_func *, void *aux);
+
+static void update_priority(struct thread *t);
+static int mlfqs_priority(struct thread *t);
+static void update_recent_cpu(struct thread *t);
+static void update_load_avg_second(int64_t second);
+static void mlq_refresh(void);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -113,22 +228,32 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&all_list);
-  list_init (&sleep_list);
 
-  if (!thread_mlfqs) {
-    list_init (&ready_list);
-  } else {
-    int i;
-    for (i = 0; i <= MLQ_SIZE; i++)
-      list_init (&mlq[i]);
-  }
+  int i;
+  for (i = 0; i < SLEEP_WHEEL0_SIZE; i++)
+    list_init (&sleep_wheel0[i]);
+  for (i = 0; i < SLEEP_WHEEL1_SIZE; i++)
+    list_init (&sleep_wheel1[i]);
+  list_init (&sleep_overflow);
+  sleep_wheel_tick = 0;
+  softirq_register (SOFTIRQ_TIMER, sleep_softirq);
+
+  for (i = 0; i <= MLQ_SIZE; i++)
+    list_init (&mlq[i]);
+  mlq_bitmap = 0;
+  heap_init (&stride_queue, stride_less, NULL);
+  stride_vtime = 0;
+  heap_init (&rt_queue, rt_less, NULL);
+  rt_density = fix_int (0);
 
   load_avg = fix_int (0);
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT, 0, fix_int(0));
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->cpu = &cpus[0];
+
+  lock_init_named (&tid_lock, "tid");
   initial_thread->tid = allocate_tid ();
 }
 
@@ -145,7 +270,8 @@ thread_start (void)
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to make itself the CPU's idle
+     thread. */
   sema_down (&idle_started);
 }
 
@@ -156,53 +282,105 @@ thread_tick (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
   struct thread *t = thread_current ();
+  struct cpu *c = t->cpu;
 
   /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
+  if (t == c->idle_thread)
+    c->idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    c->user_ticks++;
 #endif
   else
-    kernel_ticks++;
+    c->kernel_ticks++;
 
-  struct list_elem *e;
+  /* Waking sleepers can take a while, so leave it until
+     interrupts are back on. */
+  softirq_raise (SOFTIRQ_TIMER);
 
-  for (e = list_begin (&sleep_list); e != list_end (&sleep_list); ) {
-    struct thread *t = list_entry(e, struct thread, elem);
+  /* Only the running thread's recent_cpu grows, so that is the
+     only thread whose priority needs recomputing every 4 ticks.
+     Everyone else catches up on the decay when next examined. */
+  if (thread_mlfqs && t != c->idle_thread) {
+    update_recent_cpu (t);
+    t->recent_cpu = fix_add(t->recent_cpu, fix_int (1));
+  }
 
-    if (timer_elapsed(t->sleep_tick) >= 0) {
-      e = list_remove(e);
-      add_to_ready_list(t);
-    } else {
-      break; // list is sorted so stop checking
-    }
+  /* Charge the running thread for this tick. */
+  if (thread_stride && t != c->idle_thread)
+    t->pass += STRIDE1 / t->tickets;
+
+  /* A real-time thread that has used up its budget has to wait
+     for its next period; thread_yield() takes care of that. */
+  if (t->rt_period != 0) {
+    t->rt_stats.ticks++;
+    if (t->rt_left > 0)
+      t->rt_left--;
+    if (t->rt_left == 0)
+      intr_yield_on_return ();
   }
 
   if (thread_mlfqs) {
-    t->recent_cpu = fix_add(t->recent_cpu, fix_int (1));
+    int64_t now = timer_ticks ();
 
-    if (timer_ticks() % TIMER_FREQ == 0) {
-      update_load_avg();
-      thread_foreach (&update_recent_cpu, NULL);
-    }
+    if (now % TIMER_FREQ == 0)
+      update_load_avg_second (now / TIMER_FREQ);
 
-    if (timer_ticks() % 4 == 0) {
-      thread_foreach (&update_priority, NULL);
-    }
+    if (now % 4 == 0 && t != c->idle_thread)
+      update_priority (t);
   }
 
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE || (!thread_mlfqs && !is_highest_priority(t))) {
+  if (++c->thread_ticks >= TIME_SLICE || need_resched (t)) {
     intr_yield_on_return ();
   }
 }
 
+/* Called by the timer interrupt handler when it resumes the
+   periodic tick after SKIPPED ticks went by without an interrupt
+   while the idle thread was running.  Catches up on everything
+   thread_tick() would have done for those ticks. */
+void
+thread_tick_skipped (int64_t skipped)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_idle_thread (thread_current ()));
+
+  int64_t now = timer_ticks ();
+  int64_t then = now - skipped;
+
+  cpu_current ()->idle_ticks += skipped;
+  softirq_raise (SOFTIRQ_TIMER);
+
+  if (thread_mlfqs) {
+    int64_t second;
+
+    for (second = then / TIMER_FREQ + 1; second <= now / TIMER_FREQ; second++)
+      update_load_avg_second (second);
+  }
+}
+
+/* Returns the tick by which the sleeping threads next need
+   attention: the earliest wakeup, or the next cascade of the
+   timing wheel, whichever comes first. */
+int64_t
+thread_next_wakeup (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  int64_t tick;
+
+  for (tick = sleep_wheel_tick + 1; tick % SLEEP_WHEEL0_SIZE != 0; tick++)
+    if (!list_empty (&sleep_wheel0[tick % SLEEP_WHEEL0_SIZE]))
+      break;
+
+  return tick;
+}
+
 static void update_load_avg() {
   // plus 1 since at most one thread could be running
-  int running_thread = thread_current () == idle_thread ? 0 : 1;
+  int running_thread = is_idle_thread (thread_current ()) ? 0 : 1;
 
   load_avg = fix_add (
                       fix_mul (fix_frac (59, 60), load_avg),
@@ -210,7 +388,30 @@ static void update_load_avg() {
                      );
 }
 
-static void update_priority(struct thread *t, void *aux UNUSED) {
+/* Updates load_avg at the end of SECOND and records that
+   second's recent_cpu decay coefficient. */
+static void update_load_avg_second(int64_t second) {
+  update_load_avg();
+
+  decay_coeff[second % DECAY_HISTORY] =
+    fix_div (fix_mul (fix_int (2), load_avg),
+             fix_add (fix_mul (fix_int (2), load_avg), fix_int (1)));
+  load_avg_second = second;
+}
+
+/* Recomputes T's priority from its recent_cpu, first applying
+   any decay T has missed. */
+static void update_priority(struct thread *t) {
+  t->priority = mlfqs_priority (t);
+  if (!is_idle_thread (t))
+    set_effective_priority (t, t->priority);
+}
+
+/* Returns T's MLFQS priority, first applying any decay T has
+   missed. */
+static int mlfqs_priority(struct thread *t) {
+  update_recent_cpu (t);
+
   fixed_point_t recentCoeff = fix_div (t->recent_cpu, fix_int (4));
   fixed_point_t niceCoeff = fix_mul (fix_int (t->nice), fix_int (2));
 
@@ -223,51 +424,278 @@ static void update_priority(struct thread *t, void *aux UNUSED) {
 
   ASSERT (newPriority >= PRI_MIN && newPriority <= PRI_MAX);
 
-  if (t != idle_thread && t->status == THREAD_READY && newPriority != t->priority) {
-    list_remove (&t->elem);
-    list_push_back (&mlq[newPriority], &t->elem);
-  }
+  return newPriority;
+}
+
+/* Applies to T's recent_cpu every per-second decay since it was
+   last brought up to date. */
+static void update_recent_cpu(struct thread *t) {
+  int64_t second = t->recent_cpu_second;
 
-  t->priority = newPriority;
+  if (load_avg_second - second > DECAY_HISTORY)
+    second = load_avg_second - DECAY_HISTORY;
+
+  while (second < load_avg_second) {
+    second++;
+    t->recent_cpu = fix_add (fix_mul (decay_coeff[second % DECAY_HISTORY], t->recent_cpu),
+                             fix_int (t->nice));
+  }
+  t->recent_cpu_second = load_avg_second;
 }
 
-static void update_recent_cpu(struct thread *t, void *aux UNUSED) {
-  fixed_point_t coeff = fix_div (fix_mul (fix_int (2), load_avg),
-                                 fix_add (fix_mul (fix_int (2), load_avg), fix_int (1)));
-  t->recent_cpu = fix_add (fix_mul (coeff, t->recent_cpu), fix_int (t->nice));
+/* Once per second, after recent_cpu has decayed, brings every
+   ready thread up to date and requeues it at its new priority.
+   Decay can raise a thread in any queue above the head of the
+   highest one, so refreshing only the heads would not do.  Ready
+   threads' priorities change at no other time, so in between the
+   queues stay in order. */
+static void
+mlq_refresh(void) {
+  struct list stale;
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (mlq_refresh_second == load_avg_second)
+    return;
+  mlq_refresh_second = load_avg_second;
+
+  list_init (&stale);
+  for (priority = PRI_MIN; priority <= PRI_MAX; priority++)
+    while (!list_empty (&mlq[priority]))
+      list_push_back (&stale, list_pop_front (&mlq[priority]));
+  mlq_bitmap = 0;
+
+  while (!list_empty (&stale)) {
+    struct thread *t = list_entry (list_pop_front (&stale),
+                                   struct thread, elem);
+
+    t->priority = t->effective_priority = mlfqs_priority (t);
+    list_push_back (&mlq[t->effective_priority], &t->elem);
+    mlq_bitmap |= (uint64_t) 1 << t->effective_priority;
+  }
 }
 
+/* Returns true if no ready thread has higher priority than T.
+   A real-time thread outranks every other thread, and among
+   real-time threads the earliest deadline wins.  The stride
+   scheduler disregards priority, so under it any two other
+   threads rank the same. */
 bool
 is_highest_priority(struct thread *t) {
-  ASSERT(!thread_mlfqs);
-
-  if (!list_empty (&ready_list)) {
-    struct thread *head = list_entry (list_front(&ready_list), struct thread, elem);
-    return get_max_priority_donation(t) >= get_max_priority_donation(head);
+  if (!heap_empty (&rt_queue)) {
+    struct thread *first = heap_entry (heap_min (&rt_queue),
+                                       struct thread, run_elem);
+    return t->rt_period != 0
+           && rt_current_deadline (t) <= rt_current_deadline (first);
   }
+  if (t->rt_period != 0)
+    return true;
+  if (mlq_bitmap != 0)
+    return t->effective_priority >= mlq_highest_priority ();
   return true;
 }
 
+/* Returns the highest priority with a nonempty ready queue.
+   There must be at least one ready thread. */
+static int
+mlq_highest_priority (void) {
+  uint32_t high = mlq_bitmap >> 32;
+  uint32_t low = mlq_bitmap;
+  uint32_t bit;
+
+  ASSERT (mlq_bitmap != 0);
+
+  if (high != 0) {
+    asm ("bsrl %1, %0" : "=r" (bit) : "rm" (high));
+    return bit + 32;
+  }
+
+  asm ("bsrl %1, %0" : "=r" (bit) : "rm" (low));
+  return bit;
+}
+
+/* Appends T to the ready queue for its effective priority.
+   Callers that make T ready set its ready_tsc; requeuing a
+   thread that is already ready leaves it alone, so that its
+   scheduling latency counts from when it first became ready. */
 static void
 add_to_ready_list(struct thread *t) {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  if (!thread_mlfqs) {
-    list_push_back (&ready_list, &t->elem);
-    list_sort(&ready_list, &donation_less, NULL);
-  } else {
-    list_push_back (&mlq[t->priority], &t->elem);
+  if (t->rt_period != 0) {
+    /* Start a new budget period if the thread has used up its
+       budget, or the period it had budget for is over. */
+    int64_t now = timer_ticks ();
+    if (t->rt_left == 0 || now >= t->rt_release + t->rt_period) {
+      t->rt_release = now;
+      t->rt_left = t->rt_budget;
+    }
+    heap_insert (&rt_queue, &t->run_elem);
+    ready_count++;
+    return;
+  }
+
+  if (thread_stride) {
+    if (t->pass < stride_vtime)
+      t->pass = stride_vtime;
+    heap_insert (&stride_queue, &t->run_elem);
+    ready_count++;
+    return;
   }
 
+  if (thread_mlfqs)
+    t->priority = t->effective_priority = mlfqs_priority (t);
+
+  int priority = t->effective_priority;
+
+  list_push_back (&mlq[priority], &t->elem);
+  mlq_bitmap |= (uint64_t) 1 << priority;
+
   ready_count++;
 }
 
+/* Removes T from the ready queue for its effective priority. */
+static void
+remove_from_ready_list(struct thread *t) {
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->rt_period != 0) {
+    heap_remove (&rt_queue, &t->run_elem);
+    ready_count--;
+    return;
+  }
+
+  if (thread_stride) {
+    heap_remove (&stride_queue, &t->run_elem);
+    ready_count--;
+    return;
+  }
+
+  int priority = t->effective_priority;
+
+  list_remove (&t->elem);
+  if (list_empty (&mlq[priority]))
+    mlq_bitmap &= ~((uint64_t) 1 << priority);
+
+  ready_count--;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void)
 {
+  long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+  unsigned i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      idle_ticks += cpus[i].idle_ticks;
+      kernel_ticks += cpus[i].kernel_ticks;
+      user_ticks += cpus[i].user_ticks;
+    }
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld page cache hits, %lld misses\n",
+          thread_cache_hits, thread_cache_misses);
+  if (rt_jobs != 0)
+    printf ("Thread: %lld real-time jobs, %lld deadline misses\n",
+            rt_jobs, rt_misses);
+
+  printf ("Latency: wakeup-to-run TSC cycles, as log2(cycles):count\n");
+  if (!thread_mlfqs)
+    {
+      int priority;
+
+      for (priority = PRI_MAX; priority >= PRI_MIN; priority--)
+        {
+          char label[32];
+
+          snprintf (label, sizeof label, "priority %d", priority);
+          print_latency (label, latency_hist[priority]);
+        }
+    }
+  else
+    {
+      int low;
+
+      for (low = PRI_MAX + 1 - LATENCY_CLASS_SIZE; low >= PRI_MIN;
+           low -= LATENCY_CLASS_SIZE)
+        {
+          unsigned counts[LATENCY_BUCKETS];
+          char label[32];
+          int bucket, priority;
+
+          for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+            {
+              counts[bucket] = 0;
+              for (priority = low; priority < low + LATENCY_CLASS_SIZE;
+                   priority++)
+                counts[bucket] += latency_hist[priority][bucket];
+            }
+          snprintf (label, sizeof label, "priorities %d-%d",
+                    low, low + LATENCY_CLASS_SIZE - 1);
+          print_latency (label, counts);
+        }
+    }
+}
+
+/* Prints the latency histogram COUNTS, labeled LABEL, on one
+   line, unless it is empty. */
+static void
+print_latency (const char *label, const unsigned counts[])
+{
+  unsigned total = 0;
+  int bucket;
+
+  for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    total += counts[bucket];
+  if (total == 0)
+    return;
+
+  printf ("Latency: %s, %u runs:", label, total);
+  for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    if (counts[bucket] != 0)
+      printf (" %d:%u", bucket, counts[bucket]);
+  printf ("\n");
+}
+
+/* Copies up to CNT buckets of the wakeup-to-run latency
+   histogram for PRIORITY into COUNTS.  Returns the number of
+   buckets in the histogram, LATENCY_BUCKETS, or -1 if PRIORITY
+   is out of range. */
+int
+thread_get_latency (int priority, unsigned counts[], int cnt)
+{
+  enum intr_level old_level;
+  int bucket;
+
+  if (priority < PRI_MIN || priority > PRI_MAX)
+    return -1;
+
+  old_level = intr_disable ();
+  for (bucket = 0; bucket < cnt && bucket < LATENCY_BUCKETS; bucket++)
+    counts[bucket] = latency_hist[priority][bucket];
+  intr_set_level (old_level);
+
+  return LATENCY_BUCKETS;
+}
+
+/* Returns the histogram bucket for a latency of CYCLES. */
+static int
+latency_bucket (uint64_t cycles)
+{
+  uint32_t high = cycles >> 32;
+  uint32_t low = cycles;
+  int log2;
+
+  if (high != 0)
+    log2 = 63 - __builtin_clz (high);
+  else if (low != 0)
+    log2 = 31 - __builtin_clz (low);
+  else
+    log2 = 0;
+  return log2 < LATENCY_BUCKETS ? log2 : LATENCY_BUCKETS - 1;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -291,53 +719,137 @@ thread_create_process (const char *name, struct process *proc,
                        int priority, thread_func *function, void *aux)
 {
   struct thread *t;
-  struct kernel_thread_frame *kf;
-  struct switch_entry_frame *ef;
-  struct switch_threads_frame *sf;
-  tid_t tid;
 
-  ASSERT (function != NULL);
-
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_alloc (name, proc, priority, function, aux);
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
-  init_thread (t, name, priority, thread_current ()-> nice, thread_current ()->recent_cpu);
-  tid = t->tid = allocate_tid ();
-  t->proc = proc;
-
-  /* Stack frame for kernel_thread(). */
-  kf = alloc_frame (t, sizeof *kf);
-  kf->eip = NULL;
-  kf->function = function;
-  kf->aux = aux;
-
-  /* Stack frame for switch_entry(). */
-  ef = alloc_frame (t, sizeof *ef);
-  ef->eip = (void (*) (void)) kernel_thread;
-
-  /* Stack frame for switch_threads(). */
-  sf = alloc_frame (t, sizeof *sf);
-  sf->eip = switch_entry;
-  sf->ebp = 0;
-
   /* Add to run queue. */
   thread_unblock (t);
 
-  if (!thread_mlfqs && !is_highest_priority (thread_current ()))
+  if (need_resched (thread_current ()))
       thread_yield();
 
-  return tid;
-
-
+  return t->tid;
 }
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
 {
+#ifdef USERPROG
   return thread_create_process(name, thread_current ()->proc, priority, function, aux);
+#else
+  return thread_create_process(name, NULL, priority, function, aux);
+#endif
+}
+
+/* Creates a new real-time kernel thread named NAME, which
+   executes FUNCTION passing AUX as the argument, as
+   thread_create().
+
+   The thread runs a job every PERIOD timer ticks, which should be
+   done within DEADLINE ticks of its release, and uses at most
+   BUDGET ticks of CPU time per period; once it uses up its budget
+   it is not run again until its next period.  FUNCTION signals
+   the end of each job by calling thread_rt_next_period().  Ready
+   real-time threads run ahead of all other threads, earliest
+   deadline first.
+
+   Returns TID_ERROR if creation fails, including if admitting
+   the thread could make real-time threads miss their deadlines
+   or leave too little time for other threads. */
+tid_t
+thread_create_rt (const char *name, int64_t period, int64_t budget,
+                  int64_t deadline, thread_func *function, void *aux)
+{
+  struct process *proc = NULL;
+  fixed_point_t density;
+  struct thread *t;
+
+  ASSERT (0 < budget && budget <= deadline && deadline <= period);
+
+  /* Admission control. */
+  density = fix_frac (budget, deadline);
+  spinlock_acquire (&rt_lock);
+  if (fix_compare (fix_add (rt_density, density), RT_DENSITY_MAX) > 0) {
+    spinlock_release (&rt_lock);
+    return TID_ERROR;
+  }
+  rt_density = fix_add (rt_density, density);
+  spinlock_release (&rt_lock);
+
+#ifdef USERPROG
+  proc = thread_current ()->proc;
+#endif
+  t = thread_alloc (name, proc, PRI_MAX, function, aux);
+  if (t == NULL) {
+    spinlock_acquire (&rt_lock);
+    rt_density = fix_sub (rt_density, density);
+    spinlock_release (&rt_lock);
+    return TID_ERROR;
+  }
+
+  t->rt_period = period;
+  t->rt_budget = budget;
+  t->rt_deadline = deadline;
+  t->rt_job_release = timer_ticks ();
+
+  /* Add to run queue, which starts the first period. */
+  thread_unblock (t);
+
+  if (need_resched (thread_current ()))
+    thread_yield ();
+
+  return t->tid;
+}
+
+/* Called by a real-time thread when it has finished its job for
+   the current period.  Records whether the job met its deadline,
+   then waits for the next job's release, unless that is already
+   past. */
+void
+thread_rt_next_period (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now;
+
+  ASSERT (!intr_context ());
+  ASSERT (cur->rt_period != 0);
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+
+  cur->rt_stats.jobs++;
+  rt_jobs++;
+  if (now > cur->rt_job_release + cur->rt_deadline) {
+    cur->rt_stats.misses++;
+    rt_misses++;
+  }
+
+  cur->rt_job_release += cur->rt_period;
+  if (now < cur->rt_job_release) {
+    /* The next job gets a fresh budget. */
+    cur->rt_left = 0;
+    rt_wait_until (cur, cur->rt_job_release);
+  }
+
+  intr_set_level (old_level);
+}
+
+/* Copies the running real-time thread's deadline statistics into
+   *STATS. */
+void
+thread_rt_get_stats (struct thread_rt_stats *stats)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (cur->rt_period != 0);
+
+  old_level = intr_disable ();
+  *stats = cur->rt_stats;
+  intr_set_level (old_level);
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -352,10 +864,39 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
+  TRACE (TRACE_BLOCK, thread_current ()->tid, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
 
+/* Puts the current thread to sleep as thread_block() does, but
+   for at most TICKS timer ticks, which must be positive.  The
+   current thread must already be in a wait queue.  It is filed
+   in the timing wheel as well, and whichever of thread_unblock()
+   and the timeout comes first takes it off the other.  Returns
+   true if the timeout expired, in which case the thread is no
+   longer in its wait queue, false if it was woken first.
+
+   This function must be called with interrupts turned off. */
+bool
+thread_block_timeout (int64_t ticks)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cur->wait_queue != NULL);
+  ASSERT (ticks > 0);
+
+  cur->timed_wait = true;
+  cur->timed_out = false;
+  cur->sleep_tick = timer_ticks () + ticks;
+  sleep_insert (cur);
+  thread_block ();
+
+  return cur->timed_out;
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -373,6 +914,14 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
+  TRACE (TRACE_UNBLOCK, t->tid, 0, 0);
+  if (t->timed_wait)
+    {
+      /* Woken before its timeout, so cancel that. */
+      list_remove (&t->elem);
+      t->timed_wait = false;
+    }
+  t->ready_tsc = rdtsc ();
   add_to_ready_list(t);
   t->status = THREAD_READY;
   intr_set_level (old_level);
@@ -416,18 +965,29 @@ thread_tid (void)
 void
 thread_exit (void)
 {
+  struct thread *cur;
+
   ASSERT (!intr_context ());
 
 #ifdef USERPROG
   process_exit ();
 #endif
+  malloc_thread_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
-  list_remove (&thread_current()->allelem);
-  thread_current ()->status = THREAD_DYING;
+  cur = thread_current ();
+  if (cur->rt_period != 0)
+    {
+      spinlock_acquire (&rt_lock);
+      rt_density = fix_sub (rt_density,
+                            fix_frac (cur->rt_budget, cur->rt_deadline));
+      spinlock_release (&rt_lock);
+    }
+  list_remove_rcu (&cur->allelem);
+  cur->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
 }
@@ -443,8 +1003,20 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    add_to_ready_list (cur);
+
+  /* A real-time thread out of budget waits for its next period. */
+  if (cur->rt_period != 0 && cur->rt_left == 0
+      && timer_ticks () < cur->rt_release + cur->rt_period) {
+    rt_wait_until (cur, cur->rt_release + cur->rt_period);
+    intr_set_level (old_level);
+    return;
+  }
+
+  if (!is_idle_thread (cur))
+    {
+      cur->ready_tsc = rdtsc ();
+      add_to_ready_list (cur);
+    }
 
   cur->status = THREAD_READY;
   schedule ();
@@ -462,9 +1034,7 @@ thread_sleep (int64_t ticks) {
 
   cur->status = THREAD_BLOCKED;
   cur->sleep_tick = timer_ticks() + ticks;
-  list_push_back (&sleep_list, &cur->elem);
-
-  list_sort (&sleep_list, &sleep_less, NULL);
+  sleep_insert (cur);
 
   schedule();
 
@@ -472,20 +1042,21 @@ thread_sleep (int64_t ticks) {
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
-   This function must be called with interrupts off. */
+   The walk is an RCU read-side critical section, so FUNC must not
+   sleep, but interrupts need not be off. */
 void
 thread_foreach (thread_action_func *func, void *aux)
 {
   struct list_elem *e;
 
-  ASSERT (intr_get_level () == INTR_OFF);
-
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
+  rcu_read_lock ();
+  for (e = list_begin_rcu (&all_list); e != list_end (&all_list);
+       e = list_next_rcu (e))
     {
       struct thread *t = list_entry (e, struct thread, allelem);
       func (t, aux);
     }
+  rcu_read_unlock ();
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -493,7 +1064,10 @@ void
 thread_set_priority (int new_priority)
 {
   struct thread *curr = thread_current();
+  enum intr_level old_level = intr_disable ();
   curr->priority = new_priority;
+  update_donation (curr);
+  intr_set_level (old_level);
 
   // a lock is not needed since when schedule interrupts are turned off and the greatest
   // priority will eventually be scheduled
@@ -505,17 +1079,38 @@ thread_set_priority (int new_priority)
 int
 thread_get_priority (void)
 {
-  if (!thread_mlfqs)
-    return get_max_priority_donation(thread_current ());
-  else
-    return thread_current ()->priority;
+  return thread_current ()->effective_priority;
 }
 
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int nice)
 {
-  thread_current ()->nice = nice;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level = intr_disable ();
+
+  update_recent_cpu (cur);
+  cur->nice = nice;
+  update_priority (cur);
+
+  intr_set_level (old_level);
+}
+
+/* Returns the current thread's number of tickets. */
+int
+thread_get_tickets (void)
+{
+  return thread_current ()->tickets;
+}
+
+/* Sets the current thread's number of tickets to TICKETS, which
+   takes effect from the next tick it is charged for. */
+void
+thread_set_tickets (int tickets)
+{
+  ASSERT (TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  thread_current ()->tickets = tickets;
 }
 
 /* Returns the current thread's nice value. */
@@ -544,16 +1139,16 @@ thread_get_recent_cpu (void)
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
+   point it makes itself its CPU's idle thread, "up"s the
+   semaphore passed to it to enable thread_start() to continue,
+   and immediately blocks.  After that, the idle thread never appears in the
    ready list.  It is returned by next_thread_to_run() as a
    special case when the ready list is empty. */
 static void
 idle (void *idle_started_ UNUSED)
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  cpu_current ()->idle_thread = thread_current ();
   sema_up (idle_started);
 
   for (;;)
@@ -562,6 +1157,19 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Zero some free pages for later PAL_ZERO allocations.  An
+         interrupt that wakes a thread meanwhile need not preempt
+         us, so if any thread is now ready, go back and run it
+         instead of halting until the next interrupt. */
+      intr_enable ();
+      palloc_zero_idle ();
+      intr_disable ();
+      if (ready_count > 0)
+        continue;
+
+      /* Stop the periodic tick until something is due. */
+      timer_idle_enter (thread_next_wakeup ());
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -610,6 +1218,13 @@ is_thread (struct thread *t)
   return t != NULL && t->magic == THREAD_MAGIC;
 }
 
+/* Returns true if T is the idle thread of the CPU it runs on. */
+static bool
+is_idle_thread (const struct thread *t)
+{
+  return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void
@@ -626,31 +1241,223 @@ init_thread (struct thread *t, const char *name, int priority, int nice, fixed_p
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+  t->effective_priority = priority;
   t->nice = nice;
   t->recent_cpu = recent_cpu;
+  t->recent_cpu_second = load_avg_second;
+  t->tickets = TICKETS_DEFAULT;
   t->magic = THREAD_MAGIC;
-  list_init (&t->waiting_thread_list);
+  list_init (&t->held_locks);
 
   old_level = intr_disable ();
-  list_push_back (&all_list, &t->allelem);
+  list_push_back_rcu (&all_list, &t->allelem);
   intr_set_level (old_level);
 }
 
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching ready queue if it is ready, or repositioning it within
+   the wait queue it is blocked on. */
+static void
+set_effective_priority (struct thread *t, int priority)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status == THREAD_READY) {
+    remove_from_ready_list (t);
+    t->effective_priority = priority;
+    add_to_ready_list (t);
+  } else if (t->wait_queue != NULL) {
+    heap_remove (t->wait_queue, &t->wait_elem);
+    t->effective_priority = priority;
+    heap_insert (t->wait_queue, &t->wait_elem);
+  } else {
+    t->effective_priority = priority;
+  }
+}
+
+/* Recomputes T's effective priority as the highest of its own
+   priority and the effective priority of the first waiter on
+   each lock and reader-writer lock it holds.  If that changes
+   it, the change is passed on to the holder of the lock T is
+   waiting for, and so on down the donation chain until a
+   thread's priority stays put.  A reader-writer lock may have
+   many holders, all of which get the donation. */
+static void
+update_donation (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (t != NULL) {
+    int priority = t->priority;
+    struct list_elem *e;
+    int i;
+
+    for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+         e = list_next (e)) {
+      struct lock *l = list_entry (e, struct lock, elem);
+      priority = waiter_priority (&l->semaphore.waiters, priority);
+    }
+    for (i = 0; i < RW_HOLD_MAX; i++) {
+      struct rwlock *rw = t->rw_holds[i].rwlock;
+      if (rw != NULL) {
+        priority = waiter_priority (&rw->read_waiters, priority);
+        priority = waiter_priority (&rw->write_waiters, priority);
+      }
+    }
+
+    if (priority == t->effective_priority)
+      break;
+
+    set_effective_priority (t, priority);
+    if (t->wait_rwlock != NULL) {
+      rwlock_donate (t->wait_rwlock);
+      break;
+    }
+    t = t->wait_lock != NULL ? t->wait_lock->holder : NULL;
+  }
+}
+
+/* Returns the higher of PRIORITY and the effective priority of
+   the first thread in WAITERS. */
+static int
+waiter_priority (const struct heap *waiters, int priority)
+{
+  struct heap_elem *first = heap_min (waiters);
+
+  if (first != NULL) {
+    struct thread *w = heap_entry (first, struct thread, wait_elem);
+    if (w->effective_priority > priority)
+      priority = w->effective_priority;
+  }
+  return priority;
+}
+
+/* Passes donations from RW's waiters on to its holders. */
+static void
+rwlock_donate (struct rwlock *rw)
+{
+  struct list_elem *e;
+
+  if (rw->writer != NULL)
+    update_donation (rw->writer);
+  for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+       e = list_next (e))
+    update_donation (list_entry (e, struct rw_hold, elem)->thread);
+}
+
+/* Records that the current thread is about to block on RW, and
+   donates its priority to RW's holders. */
 void
-thread_lock_wait_acquired (struct thread *t) {
-  ASSERT(!thread_mlfqs)
-  list_remove (&t->wait_elem);
+thread_rwlock_wait_added (struct rwlock *rw)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  thread_current ()->wait_rwlock = rw;
+  if (!thread_mlfqs)
+    rwlock_donate (rw);
 }
 
+/* Records that the current thread now holds RW, for writing if
+   WRITE is true, otherwise for reading. */
+void
+thread_rwlock_acquired (struct rwlock *rw, bool write)
+{
+  struct thread *cur = thread_current ();
+  struct rw_hold *h;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  h = find_rw_hold (cur, NULL);
+  if (h == NULL)
+    PANIC ("thread holds more than %d reader-writer locks", RW_HOLD_MAX);
+
+  cur->wait_rwlock = NULL;
+  h->thread = cur;
+  h->rwlock = rw;
+  if (write)
+    rw->writer = cur;
+  else
+    list_push_back (&rw->readers, &h->elem);
+
+  if (!thread_mlfqs)
+    update_donation (cur);
+}
+
+/* Records that the current thread no longer holds RW. */
+void
+thread_rwlock_released (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  struct rw_hold *h;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  h = find_rw_hold (cur, rw);
+  ASSERT (h != NULL);
+
+  if (rw->writer == cur)
+    rw->writer = NULL;
+  else
+    list_remove (&h->elem);
+  h->rwlock = NULL;
+
+  if (!thread_mlfqs)
+    update_donation (cur);
+}
+
+/* Returns T's hold on RW, or a free hold if RW is null, or a
+   null pointer if there is none. */
+static struct rw_hold *
+find_rw_hold (struct thread *t, struct rwlock *rw)
+{
+  int i;
+
+  for (i = 0; i < RW_HOLD_MAX; i++)
+    if (t->rw_holds[i].rwlock == rw)
+      return &t->rw_holds[i];
+  return NULL;
+}
+
+/* Called when the current thread has to wait for LOCK, after it
+   has been queued on LOCK's semaphore.  It donates its priority
+   to the holder, and through it down the chain of holders. */
 void
 thread_lock_wait_added (struct lock *lock) {
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT(!thread_mlfqs)
+
   ASSERT(lock->holder != NULL);
+
+  struct thread *cur = thread_current ();
+
+  cur->wait_lock = lock;
+  update_donation (lock->holder);
+}
+
+/* Called when the current thread has acquired LOCK.  The threads
+   still waiting for LOCK now donate to the current thread. */
+void
+thread_lock_acquired (struct lock *lock) {
+  ASSERT (intr_get_level () == INTR_OFF);
   ASSERT(!thread_mlfqs)
 
-  list_push_front(&lock->holder->waiting_thread_list, &thread_current ()->wait_elem);
-  list_sort(&lock->holder->waiting_thread_list, &priority_less, NULL);
+  struct thread *cur = thread_current ();
+
+  cur->wait_lock = NULL;
+  list_push_back (&cur->held_locks, &lock->elem);
+  update_donation (cur);
+}
+
+/* Called when the current thread is about to release LOCK.  The
+   threads waiting for LOCK stop donating to the current thread,
+   whose priority falls back accordingly. */
+void
+thread_lock_released (struct lock *lock) {
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT(!thread_mlfqs)
 
-  list_sort(&ready_list, &donation_less, NULL);
+  list_remove (&lock->elem);
+  update_donation (thread_current ());
 }
 
 
@@ -664,38 +1471,130 @@ alloc_frame (struct thread *t, size_t size)
   ASSERT (size % sizeof (uint32_t) == 0);
 
   t->stack -= size;
+  memset (t->stack, 0, size);
   return t->stack;
 }
 
+/* Allocates and initializes a new thread named NAME, belonging
+   to process PROC, with the given initial PRIORITY, which will
+   execute FUNCTION passing AUX as the argument.  The thread is
+   left blocked.  Returns a null pointer if memory is exhausted. */
+static struct thread *
+thread_alloc (const char *name, struct process *proc UNUSED,
+              int priority, thread_func *function, void *aux)
+{
+  struct thread *t;
+  struct kernel_thread_frame *kf;
+  struct switch_entry_frame *ef;
+  struct switch_threads_frame *sf;
+
+  ASSERT (function != NULL);
+
+  /* Allocate thread. */
+  t = alloc_thread_page ();
+  if (t == NULL)
+    return NULL;
+
+  /* Initialize thread. */
+  init_thread (t, name, priority, thread_current ()-> nice, thread_current ()->recent_cpu);
+  t->tid = allocate_tid ();
+#ifdef USERPROG
+  t->proc = proc;
+#endif
+
+  /* Stack frame for kernel_thread(). */
+  kf = alloc_frame (t, sizeof *kf);
+  kf->eip = NULL;
+  kf->function = function;
+  kf->aux = aux;
+
+  /* Stack frame for switch_entry(). */
+  ef = alloc_frame (t, sizeof *ef);
+  ef->eip = (void (*) (void)) kernel_thread;
+
+  /* Stack frame for switch_threads(). */
+  sf = alloc_frame (t, sizeof *sf);
+  sf->eip = switch_entry;
+  sf->ebp = 0;
+
+  return t;
+}
+
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible.  Its contents are arbitrary.
+   Returns a null pointer if no page is available. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    {
+      t = thread_cache[--thread_cache_cnt];
+      thread_cache_hits++;
+    }
+  else
+    thread_cache_misses++;
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Releases dead thread T's page, keeping it in the cache if
+   there is room. */
+static void
+free_thread_page (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Make stale pointers to T fail is_thread(). */
+  t->magic = 0;
+
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   the CPU's idle thread. */
 static struct thread *
 next_thread_to_run (void)
 {
   if (ready_count == 0) {
-    return idle_thread;
+    return cpu_current ()->idle_thread;
   }
-  else {
-    ready_count--;
+  else if (!heap_empty (&rt_queue)) {
+    struct thread *t = heap_entry (heap_min (&rt_queue),
+                                   struct thread, run_elem);
 
-    if (!thread_mlfqs) {
-      return list_entry (list_pop_front (&ready_list), struct thread, elem);
-    } else {
-      int i;
-      for ( i = PRI_MAX; i >= PRI_MIN; i--) {
-        if (!list_empty (&mlq[i])) {
-          return list_entry (list_pop_front (&mlq[i]), struct thread, elem);
-        }
-      }
+    remove_from_ready_list (t);
+    return t;
+  }
+  else if (thread_stride) {
+    struct thread *t = heap_entry (heap_min (&stride_queue),
+                                   struct thread, run_elem);
 
-      // panic since something is seriously wrong
-      ASSERT(false);
+    remove_from_ready_list (t);
+    stride_vtime = t->pass;
+    return t;
+  }
+  else {
+    if (thread_mlfqs)
+      mlq_refresh ();
 
-      return NULL;
-    }
+    struct list *queue = &mlq[mlq_highest_priority ()];
+    struct thread *t = list_entry (list_front (queue), struct thread, elem);
+
+    remove_from_ready_list (t);
+    return t;
   }
 }
 
@@ -724,9 +1623,18 @@ thread_schedule_tail (struct thread *prev)
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  rcu_quiescent ();
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->thread_ticks = 0;
+
+  /* Account for the time we spent ready. */
+  if (cur->ready_tsc != 0)
+    {
+      int bucket = latency_bucket (rdtsc () - cur->ready_tsc);
+      latency_hist[cur->effective_priority][bucket]++;
+      cur->ready_tsc = 0;
+    }
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -737,12 +1645,14 @@ thread_schedule_tail (struct thread *prev)
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
-     palloc().) */
+     palloc().)  PREV left all_list before it called schedule(),
+     which is an RCU quiescent state, so no reader can still be
+     looking at it. */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
 
-      palloc_free_page (prev);
+      free_thread_page (prev);
     }
 
 }
@@ -763,8 +1673,11 @@ schedule (void)
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+  ASSERT (cur->cpu->spin_depth == 0);
   ASSERT (is_thread (next));
 
+  TRACE (TRACE_SCHEDULE, cur->tid, next->tid, cur->status);
+  next->cpu = cur->cpu;
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
@@ -785,65 +1698,173 @@ allocate_tid (void)
   return tid;
 }
 
-/* Sort by priority donation
- * If a thread is holding a lock where any of the waiting threads has a
- * higher priority than itself then  use the max of that.
-*/
-bool
-donation_less (const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED)
+/* Files sleeping thread T into the timing wheel slot for its
+   sleep_tick, relative to the last expired tick.  T must not be
+   due before that tick, and may only be due at it while the slot
+   for that tick has yet to be expired, that is, while cascading. */
+static void
+sleep_insert (struct thread *t)
 {
-  struct thread *a = list_entry (a_, struct thread, elem);
-  struct thread *b = list_entry (b_, struct thread, elem);
-  return get_max_priority_donation(a) > get_max_priority_donation(b);
+  int64_t due = t->sleep_tick;
+  int64_t delta = due - sleep_wheel_tick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (delta >= 0);
+
+  if (delta < SLEEP_WHEEL0_SIZE)
+    list_push_back (&sleep_wheel0[due % SLEEP_WHEEL0_SIZE], &t->elem);
+  else if (delta < SLEEP_WHEEL0_SIZE * SLEEP_WHEEL1_SIZE)
+    list_push_back (&sleep_wheel1[(due >> SLEEP_WHEEL0_BITS)
+                                  % SLEEP_WHEEL1_SIZE], &t->elem);
+  else
+    list_push_back (&sleep_overflow, &t->elem);
 }
 
-static int get_max_priority_donation (struct thread *a) {
-  ASSERT(!thread_mlfqs)
-  return get_max_priority_donation_helper(a, 0);
+/* Refiles every thread in SLOT one level further down the
+   timing wheel. */
+static void
+sleep_cascade (struct list *slot)
+{
+  struct list pending;
+
+  list_init (&pending);
+  list_splice (list_end (&pending), list_begin (slot), list_end (slot));
+
+  while (!list_empty (&pending))
+    sleep_insert (list_entry (list_pop_front (&pending), struct thread, elem));
 }
 
-static
-int get_max_priority_donation_helper (struct thread *a, int depth) {
-  ASSERT(depth < 10);
+/* Expires sleeping threads tick by tick until the wheel has
+   caught up with NOW, waking every thread due by then. */
+static void
+sleep_advance (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  int t_priority = a->priority;
-  int t_donation = PRI_MIN;
+  while (sleep_wheel_tick < now)
+    {
+      struct list *slot;
 
-  struct list *wait_list = &a->waiting_thread_list;
+      sleep_wheel_tick++;
+      if (sleep_wheel_tick % SLEEP_WHEEL0_SIZE == 0)
+        {
+          int64_t block = sleep_wheel_tick >> SLEEP_WHEEL0_BITS;
 
-  if (!list_empty (wait_list)) {
-    // wait sorted descending priority order
-    struct thread *wait_t = list_entry (list_begin (wait_list), struct thread, wait_elem);
-    int wait_max_priority = get_max_priority_donation_helper(wait_t, depth+1);
-    t_donation = t_donation > wait_max_priority ? t_donation : wait_max_priority;
-  }
+          if (block % SLEEP_WHEEL1_SIZE == 0)
+            sleep_cascade (&sleep_overflow);
+          sleep_cascade (&sleep_wheel1[block % SLEEP_WHEEL1_SIZE]);
+        }
+
+      /* Everything filed in this slot is due exactly now. */
+      slot = &sleep_wheel0[sleep_wheel_tick % SLEEP_WHEEL0_SIZE];
+      while (!list_empty (slot))
+        sleep_expire (list_entry (list_pop_front (slot),
+                                  struct thread, elem));
+    }
+}
+
+/* Wakes T, whose sleep has expired and which has already been
+   taken out of the timing wheel.  If T was in a timed wait, takes
+   it off the wait queue too, and withdraws the priority it was
+   donating to the holder of the lock it was acquiring. */
+static void
+sleep_expire (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->timed_wait)
+    {
+      t->timed_wait = false;
+      t->timed_out = true;
+      heap_remove (t->wait_queue, &t->wait_elem);
+      t->wait_queue = NULL;
+      if (t->wait_lock != NULL)
+        {
+          struct thread *holder = t->wait_lock->holder;
+
+          t->wait_lock = NULL;
+          if (!thread_mlfqs)
+            update_donation (holder);
+        }
+    }
+  thread_unblock (t);
+}
+
+/* Orders threads in the stride run queue by pass, then by tid. */
+static bool
+stride_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, run_elem);
+  const struct thread *b = heap_entry (b_, struct thread, run_elem);
 
-  return t_priority > t_donation ? t_priority : t_donation;
+  if (a->pass != b->pass)
+    return a->pass < b->pass;
+  return a->tid < b->tid;
 }
 
-/* Sort fn based on time_sleep_ticks */
+/* Orders threads in the EDF run queue by deadline, then by tid. */
 static bool
-sleep_less (const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED)
+rt_less (const struct heap_elem *a_, const struct heap_elem *b_,
+         void *aux UNUSED)
 {
-  const struct thread *a = list_entry (a_, struct thread, elem);
-  const struct thread *b = list_entry (b_, struct thread, elem);
+  const struct thread *a = heap_entry (a_, struct thread, run_elem);
+  const struct thread *b = heap_entry (b_, struct thread, run_elem);
+  int64_t a_deadline = rt_current_deadline (a);
+  int64_t b_deadline = rt_current_deadline (b);
+
+  if (a_deadline != b_deadline)
+    return a_deadline < b_deadline;
+  return a->tid < b->tid;
+}
 
-  return a->sleep_tick < b->sleep_tick;
+/* Returns the absolute deadline by which real-time thread T is
+   scheduled, that of its current budget period. */
+static int64_t
+rt_current_deadline (const struct thread *t)
+{
+  return t->rt_release + t->rt_deadline;
 }
 
-/* Sort fn based on priority */
-bool
-priority_less (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+/* Blocks real-time thread T, which must be the running thread,
+   until tick RELEASE, when its budget is replenished. */
+static void
+rt_wait_until (struct thread *t, int64_t release)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t == thread_current ());
+
+  t->status = THREAD_BLOCKED;
+  t->sleep_tick = release;
+  sleep_insert (t);
+  schedule ();
+}
+
+/* Returns true if a ready thread should preempt running thread T.
+   The MLFQS does not preempt for priority, but real-time threads
+   preempt under every scheduler. */
+static bool
+need_resched (struct thread *t)
+{
+  return (!thread_mlfqs || !heap_empty (&rt_queue))
+         && !is_highest_priority (t);
+}
+
+/* Timer softirq.  Wakes the threads whose sleep has expired by
+   the current tick, and preempts the running thread if one of
+   them should run instead. */
+static void
+sleep_softirq (void)
 {
-  const struct thread *a = list_entry (a_, struct thread, elem);
-  const struct thread *b = list_entry (b_, struct thread, elem);
+  enum intr_level old_level = intr_disable ();
 
-  return a->priority > b->priority;
+  sleep_advance (timer_ticks ());
+  if (need_resched (thread_current ()))
+    intr_yield_on_return ();
+
+  intr_set_level (old_level);
 }
 
-
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
@@ -3,9 +3,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <priority.h>
 #include <stdint.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
+#include "threads/malloc.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -21,16 +23,36 @@ enum thread_status
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
 
-/* Thread priorities. */
-#define PRI_MIN 0                       /* Lowest priority. */
-#define PRI_DEFAULT 31                  /* Default priority. */
-#define PRI_MAX 63                      /* Highest priority. */
-
 #define NICE_MIN = -20
 #define NICE_MAX = 20
 
+/* Most reader-writer locks a thread may hold at once. */
+#define RW_HOLD_MAX 4
+
+/* Thread tickets, for the stride scheduler. */
+#define TICKETS_MIN 1                   /* Smallest share. */
+#define TICKETS_DEFAULT 100             /* Default share. */
+#define TICKETS_MAX 1000                /* Largest share. */
+
+/* Deadline statistics for a real-time thread. */
+struct thread_rt_stats
+  {
+    int jobs;                   /* Jobs completed. */
+    int misses;                 /* Jobs completed after their deadline. */
+    int64_t ticks;              /* Timer ticks of CPU time used. */
+  };
+
+/* Number of buckets in a scheduling latency histogram.  Bucket
+   N counts latencies of 2**N through 2**(N+1) - 1 TSC cycles,
+   except that bucket 0 also counts 0 cycles and the last bucket
+   also counts everything longer. */
+#define LATENCY_BUCKETS 32
+
 #define MLQ_SIZE (PRI_MAX - PRI_MIN)
 
+struct cpu;
+struct process;
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -82,30 +104,60 @@ typedef int tid_t;
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
+   the run queue (thread.c), or it can be an element in the list
+   of sleeping threads (thread.c).  It can be used these two ways
    only because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   blocked state is asleep.  A thread blocked on a semaphore, lock
+   or condition variable is in its wait queue through `wait_elem'
+   instead.  The stride scheduler's run queue is a heap, which
+   ready threads are in through `run_elem'. */
 struct thread
   {
     /* Owned by thread.c. */
     tid_t tid;                          /* Thread identifier. */
     enum thread_status status;          /* Thread state. */
+    struct cpu *cpu;                    /* CPU it last ran on, if any. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    int effective_priority;             /* Priority including donations. */
     int nice;
     fixed_point_t recent_cpu;
+    int64_t recent_cpu_second;          /* Last second of decay applied to recent_cpu. */
+    int tickets;                        /* CPU share under the stride scheduler. */
+    int64_t pass;                       /* Stride scheduler virtual time. */
+    struct heap_elem run_elem;          /* Element in stride or EDF run queue. */
+
+    /* Real-time parameters, in timer ticks.  See thread_create_rt(). */
+    int64_t rt_period;                  /* Period, or 0 if not real-time. */
+    int64_t rt_budget;                  /* CPU time allowed per period. */
+    int64_t rt_deadline;                /* Deadline relative to release. */
+    int64_t rt_release;                 /* Start of current budget period. */
+    int64_t rt_left;                    /* Budget left in current period. */
+    int64_t rt_job_release;             /* Release time of current job. */
+    struct thread_rt_stats rt_stats;    /* Deadline statistics. */
+    uint64_t ready_tsc;                 /* TSC when made ready, or 0. */
     uint64_t sleep_tick;
-    struct list waiting_thread_list;    /* list of threads waiting for this thread's acquired locks */
+    bool timed_wait;                    /* In sleep wheel and a wait queue? */
+    bool timed_out;                     /* Timed wait expired? */
+    struct list held_locks;             /* Locks held, which may carry donations. */
+    struct rw_hold rw_holds[RW_HOLD_MAX]; /* Reader-writer locks held. */
     struct list_elem allelem;           /* List element for all threads list. */
 
-    struct list_elem wait_elem;         /* List element used to indicate this thread is blocked by waiting for a lock */
+    /* Shared between thread.c and synch.c. */
+    struct heap_elem wait_elem;         /* Element in a wait queue. */
+    struct heap *wait_queue;            /* Wait queue this thread is in, if any. */
+    unsigned wait_seq;                  /* Arrival order in wait_queue. */
+    struct lock *wait_lock;             /* Lock this thread is blocked acquiring, if any. */
+    struct rwlock *wait_rwlock;         /* Reader-writer lock it is blocked on, if any. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by threads/malloc.c. */
+    struct malloc_magazine magazines[MALLOC_CLASS_CNT]; /* Free blocks. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -116,26 +168,43 @@ struct thread
     unsigned magic;                     /* Detects stack overflow. */
   };
 
-void thread_lock_wait_acquired (struct thread *t);
-void thread_lock_wait_added(struct lock *lock);
-bool donation_less (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
+void thread_lock_wait_added (struct lock *lock);
+void thread_lock_acquired (struct lock *lock);
+void thread_lock_released (struct lock *lock);
+void thread_rwlock_wait_added (struct rwlock *);
+void thread_rwlock_acquired (struct rwlock *, bool write);
+void thread_rwlock_released (struct rwlock *);
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which gives each thread a
+   share of the CPU in proportion to its tickets, regardless of
+   priority.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_tick_skipped (int64_t skipped);
+int64_t thread_next_wakeup (void);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 tid_t thread_create_process (const char *name, struct process *, int priority, thread_func *, void *);
+tid_t thread_create_rt (const char *name, int64_t period, int64_t budget,
+                        int64_t deadline, thread_func *, void *);
+void thread_rt_next_period (void);
+void thread_rt_get_stats (struct thread_rt_stats *);
+int thread_get_latency (int priority, unsigned counts[], int cnt);
 
 void thread_block (void);
+bool thread_block_timeout (int64_t ticks);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
@@ -159,6 +228,9 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+int thread_get_tickets (void);
+void thread_set_tickets (int);
+
 
 
 #endif /* threads/thread.h */
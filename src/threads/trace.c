@@ -0,0 +1,164 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+#include "threads/vaddr.h"
+#ifdef FILESYS
+#include "filesys/fsutil.h"
+#endif
+
+/* Number of pages in the trace buffer.  The buffer holds a
+   struct trace_header followed by as many records as fit. */
+#define TRACE_PAGES 64
+
+/* True while tracepoints are recording. */
+bool trace_enabled;
+
+/* Trace buffer: header, then ring of records. */
+static struct trace_header *trace_hdr;
+static struct trace_record *trace_ring;
+static size_t trace_capacity;   /* Number of records in ring. */
+static uint64_t trace_total;    /* Number of records ever written. */
+
+/* Time at which tracing started, for calibrating the TSC. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static tid_t current_tid (void);
+static void reverse_records (struct trace_record *, size_t cnt);
+
+/* Allocates the trace buffer and turns tracing on.  Must be
+   called after palloc_init().  If memory is short, prints a
+   warning and leaves tracing off. */
+void
+trace_init (void)
+{
+  trace_hdr = palloc_get_multiple (0, TRACE_PAGES);
+  if (trace_hdr == NULL)
+    {
+      printf ("trace: could not allocate %d-page buffer\n", TRACE_PAGES);
+      return;
+    }
+  trace_ring = (struct trace_record *) (trace_hdr + 1);
+  trace_capacity = ((TRACE_PAGES * PGSIZE - sizeof *trace_hdr)
+                    / sizeof *trace_ring);
+
+  start_tsc = rdtsc ();
+  start_ticks = timer_ticks ();
+  trace_enabled = true;
+}
+
+/* Appends a record of EVENT, with arguments A0, A1, and A2, to
+   the trace buffer.  Use the TRACE macro instead of calling this
+   directly.  May be called from any context. */
+void
+trace_event (enum trace_event event, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+  enum intr_level old_level;
+  struct trace_record *r;
+
+  ASSERT (event < TRACE_EVENT_CNT);
+
+  old_level = intr_disable ();
+  if (trace_enabled)
+    {
+      r = &trace_ring[trace_total++ % trace_capacity];
+      r->tsc = rdtsc ();
+      r->event = event;
+      r->tid = current_tid ();
+      r->arg[0] = a0;
+      r->arg[1] = a1;
+      r->arg[2] = a2;
+    }
+  intr_set_level (old_level);
+}
+
+/* Turns tracing off and writes the trace buffer to the scratch
+   device.  Must be called in thread context with interrupts on,
+   because writing a block device sleeps.  Only kernels with a
+   file system have a scratch device; in others this just turns
+   tracing off. */
+void
+trace_dump (void)
+{
+  size_t cnt, oldest;
+  int64_t ticks;
+
+  if (trace_hdr == NULL)
+    return;
+  trace_enabled = false;
+
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    {
+      printf ("trace: cannot write trace with interrupts off\n");
+      return;
+    }
+
+  /* Rotate the ring in place so that the oldest record comes
+     first. */
+  cnt = trace_total < trace_capacity ? trace_total : trace_capacity;
+  oldest = trace_total % trace_capacity;
+  if (trace_total > trace_capacity && oldest != 0)
+    {
+      reverse_records (trace_ring, oldest);
+      reverse_records (trace_ring + oldest, cnt - oldest);
+      reverse_records (trace_ring, cnt);
+    }
+
+  memcpy (trace_hdr->magic, TRACE_MAGIC, sizeof trace_hdr->magic);
+  trace_hdr->version = TRACE_VERSION;
+  trace_hdr->record_size = sizeof *trace_ring;
+  trace_hdr->record_cnt = cnt;
+  trace_hdr->dropped = trace_total - cnt;
+  ticks = timer_elapsed (start_ticks);
+  trace_hdr->tsc_freq = (ticks > 0
+                         ? (rdtsc () - start_tsc) * TIMER_FREQ / ticks
+                         : 0);
+
+#ifdef FILESYS
+  if (!fsutil_append_data ("trace", trace_hdr,
+                           sizeof *trace_hdr + cnt * sizeof *trace_ring))
+    printf ("trace: could not write trace to scratch device\n");
+#endif
+}
+
+/* Prints trace statistics. */
+void
+trace_print_stats (void)
+{
+  if (trace_hdr != NULL)
+    printf ("Trace: %llu records, %llu dropped\n", trace_total,
+            trace_total > trace_capacity ? trace_total - trace_capacity : 0);
+}
+
+/* Reverses the order of the CNT records starting at R. */
+static void
+reverse_records (struct trace_record *r, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt / 2; i++)
+    {
+      struct trace_record tmp = r[i];
+      r[i] = r[cnt - 1 - i];
+      r[cnt - 1 - i] = tmp;
+    }
+}
+
+/* Returns the running thread's tid.  Tracepoints fire in the
+   middle of thread switches, where thread_current()'s sanity
+   checks do not hold, so this finds the thread the same way
+   running_thread() does, from the stack pointer. */
+static tid_t
+current_tid (void)
+{
+  uint32_t *esp;
+
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->tid;
+}
@@ -0,0 +1,78 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   Tracepoints are compiled into the scheduler, the
+   synchronization primitives, the interrupt handler, the block
+   layer, and the system call handler.  Each one costs a single
+   test of a global flag until tracing is turned on with the
+   "-trace" kernel option.  Then every tracepoint that fires
+   appends a fixed-size binary record to a ring buffer in kernel
+   memory, overwriting the oldest record when the buffer is full.
+
+   At power off, a kernel with a file system writes the buffer to
+   the scratch device as a ustar member named "trace", after any
+   files appended there.  "pintos --trace=FILE" retrieves it, and
+   utils/trace-decode prints it as a timeline. */
+
+/* Trace events.  The meanings of each event's arguments are
+   listed in its comment. */
+enum trace_event
+  {
+    TRACE_SCHEDULE,             /* Prev tid, next tid, prev status. */
+    TRACE_BLOCK,                /* Tid. */
+    TRACE_UNBLOCK,              /* Tid. */
+    TRACE_SEMA_DOWN,            /* Semaphore address, value. */
+    TRACE_SEMA_UP,              /* Semaphore address, value. */
+    TRACE_INTR_ENTER,           /* Vector number. */
+    TRACE_INTR_EXIT,            /* Vector number. */
+    TRACE_BLOCK_READ,           /* Block type, sector. */
+    TRACE_BLOCK_WRITE,          /* Block type, sector. */
+    TRACE_SYSCALL,              /* System call number. */
+    TRACE_EVENT_CNT             /* Number of events. */
+  };
+
+/* A trace record, as stored in the ring buffer and in the dump. */
+struct trace_record
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint16_t event;             /* A TRACE_* event. */
+    uint16_t tid;               /* Running thread. */
+    uint32_t arg[3];            /* Event-specific arguments. */
+  };
+
+/* Header at the start of a trace dump.  The records follow it,
+   oldest first. */
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC, not null-terminated. */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint32_t record_size;       /* sizeof (struct trace_record). */
+    uint32_t record_cnt;        /* Number of records that follow. */
+    uint32_t dropped;           /* Number of records overwritten. */
+    uint64_t tsc_freq;          /* Time-stamp counter ticks per second. */
+  };
+
+#define TRACE_MAGIC "PINTRACE"
+#define TRACE_VERSION 1
+
+/* Records EVENT with arguments A0, A1, and A2, if tracing is on. */
+#define TRACE(EVENT, A0, A1, A2)                                        \
+        do {                                                            \
+          if (trace_enabled)                                            \
+            trace_event (EVENT, (uint32_t) (A0), (uint32_t) (A1),       \
+                         (uint32_t) (A2));                              \
+        } while (0)
+
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_event (enum trace_event, uint32_t, uint32_t, uint32_t);
+void trace_dump (void);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
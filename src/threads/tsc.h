@@ -0,0 +1,18 @@
+#ifndef THREADS_TSC_H
+#define THREADS_TSC_H
+
+#include <stdint.h>
+
+/* Returns the CPU's time-stamp counter, which counts clock
+   cycles since reset.  Reading it is much cheaper than reading
+   the timer, and far finer grained, so it is the right clock
+   for measuring short intervals.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/tsc.h */
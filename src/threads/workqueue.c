@@ -0,0 +1,188 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Maximum number of passes softirq_run() makes over the pending
+   softirqs.  Softirqs raised again after that many passes, which
+   can happen if a device keeps interrupting, are left for the
+   next interrupt to run, so that a busy device cannot keep the
+   interrupted thread from running indefinitely. */
+#define SOFTIRQ_MAX_PASSES 10
+
+/* Softirq handlers, indexed by softirq number. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+
+/* Bit N is set if softirq N has been raised but not yet run. */
+static uint32_t softirq_mask;
+
+/* Workqueue drained by work_queue(). */
+static struct workqueue *system_wq;
+
+static thread_func worker;
+
+/* Registers HANDLER as the handler for SOFTIRQ. */
+void
+softirq_register (enum softirq softirq, softirq_func *handler)
+{
+  ASSERT (softirq < SOFTIRQ_CNT);
+  ASSERT (softirq_handlers[softirq] == NULL);
+
+  softirq_handlers[softirq] = handler;
+}
+
+/* Arranges for SOFTIRQ's handler to run on return from the
+   current external interrupt or, if called outside one, on
+   return from the next. */
+void
+softirq_raise (enum softirq softirq)
+{
+  enum intr_level old_level;
+
+  ASSERT (softirq < SOFTIRQ_CNT);
+
+  old_level = intr_disable ();
+  softirq_mask |= 1u << softirq;
+  intr_set_level (old_level);
+}
+
+/* Returns true if any softirq has been raised but not yet run. */
+bool
+softirq_pending (void)
+{
+  return softirq_mask != 0;
+}
+
+/* Runs the handlers of the pending softirqs with interrupts on.
+   Called by intr_handler() with interrupts off, and returns with
+   them off. */
+void
+softirq_run (void)
+{
+  int pass;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (intr_context ());
+
+  for (pass = 0; pass < SOFTIRQ_MAX_PASSES && softirq_mask != 0; pass++)
+    {
+      uint32_t mask = softirq_mask;
+      int softirq;
+
+      softirq_mask = 0;
+      intr_enable ();
+      for (softirq = 0; softirq < SOFTIRQ_CNT; softirq++)
+        if ((mask & (1u << softirq)) != 0 && softirq_handlers[softirq] != NULL)
+          softirq_handlers[softirq] ();
+      intr_disable ();
+    }
+}
+
+/* Initializes W to run FUNC, which may retrieve AUX from
+   W->aux. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Creates the system workqueue.  Must be called after
+   thread_start(), since it creates a thread. */
+void
+workqueue_init (void)
+{
+  system_wq = workqueue_create ("kworker", PRI_DEFAULT);
+  if (system_wq == NULL)
+    PANIC ("could not create system workqueue");
+}
+
+/* Creates a workqueue whose worker thread, named NAME, runs at
+   PRIORITY.  Returns the new workqueue, or a null pointer if
+   memory is exhausted. */
+struct workqueue *
+workqueue_create (const char *name, int priority)
+{
+  struct workqueue *wq;
+
+  ASSERT (!intr_context ());
+
+  wq = malloc (sizeof *wq);
+  if (wq == NULL)
+    return NULL;
+
+  list_init (&wq->items);
+  sema_init (&wq->ready, 0);
+  if (thread_create (name, priority, worker, wq) == TID_ERROR)
+    {
+      free (wq);
+      return NULL;
+    }
+  return wq;
+}
+
+/* Queues W to run on WQ's worker thread.  Returns true if
+   successful, false if W was already queued and has not yet
+   started running, in which case it will still run just once.
+   May be called from interrupt context. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = true;
+      list_push_back (&wq->items, &w->elem);
+      sema_up (&wq->ready);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Queues W on the system workqueue, as workqueue_queue(). */
+bool
+work_queue (struct work *w)
+{
+  ASSERT (system_wq != NULL);
+
+  return workqueue_queue (system_wq, w);
+}
+
+/* Worker thread for workqueue WQ_.  Runs queued work items one
+   at a time, in order, with interrupts on.  A work item may be
+   queued again, even by its own function, as soon as it starts
+   running. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w;
+
+      sema_down (&wq->ready);
+
+      old_level = intr_disable ();
+      w = list_entry (list_pop_front (&wq->items), struct work, elem);
+      w->pending = false;
+      intr_set_level (old_level);
+
+      w->func (w);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/* Deferred work.
+
+   External interrupt handlers run with interrupts off, so every
+   instruction they execute adds to the latency of the next
+   interrupt.  This module lets them hand work off to run later,
+   in one of two ways.
+
+   A softirq is a handler that runs on the way out of an external
+   interrupt, after the PIC has been acknowledged, with interrupts
+   turned back on.  It still runs in interrupt context, so it may
+   not sleep, but it may itself be interrupted.  Softirqs are
+   identified by a fixed set of numbers, so that raising one from
+   an interrupt handler is just setting a bit.  However many
+   times a softirq is raised before it gets to run, it runs once,
+   which lets a driver batch up its completions.
+
+   A workqueue is a kernel thread that runs work items queued to
+   it, in order, at the priority it was created with.  Work items
+   run in thread context and so may sleep.  Work may be queued
+   from interrupt context. */
+
+/* Softirq numbers. */
+enum softirq
+  {
+    SOFTIRQ_TIMER,              /* Wakes sleeping threads. */
+    SOFTIRQ_BLOCK,              /* Completes block device requests. */
+    SOFTIRQ_CNT                 /* Number of softirqs. */
+  };
+
+typedef void softirq_func (void);
+
+void softirq_register (enum softirq, softirq_func *);
+void softirq_raise (enum softirq);
+bool softirq_pending (void);
+void softirq_run (void);
+
+/* A work item. */
+struct work;
+typedef void work_func (struct work *);
+
+struct work
+  {
+    struct list_elem elem;      /* Element in workqueue's list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Queued but not yet started? */
+  };
+
+/* A workqueue. */
+struct workqueue
+  {
+    struct list items;          /* Queued work items. */
+    struct semaphore ready;     /* Number of queued work items. */
+  };
+
+void work_init (struct work *, work_func *, void *aux);
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int priority);
+bool workqueue_queue (struct workqueue *, struct work *);
+bool work_queue (struct work *);
+
+#endif /* threads/workqueue.h */
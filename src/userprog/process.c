@@ -17,6 +17,7 @@
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -41,9 +42,21 @@ static void free_fd (struct file_descriptor *f);
 // a parent which makes the code simpler
 static struct process *initial_process;
 
+// caches of processes, their file descriptors, and the
+// arguments passed to start_process
+static struct kmem_cache *process_cache;
+static struct kmem_cache *fd_cache;
+static struct kmem_cache *process_arg_cache;
+
 void
 process_init (void)
 {
+  process_cache = kmem_cache_create ("process", sizeof (struct process),
+                                     NULL);
+  fd_cache = kmem_cache_create ("file_descriptor",
+                                sizeof (struct file_descriptor), NULL);
+  process_arg_cache = kmem_cache_create ("process_arg",
+                                         sizeof (struct process_arg), NULL);
   initial_process = process_create ();
 }
 
@@ -62,7 +75,7 @@ process_current (void)
 
 struct process_arg *
 process_arg_create (void) {
-  struct process_arg *proc_arg = malloc (sizeof (*proc_arg));
+  struct process_arg *proc_arg = kmem_cache_alloc (process_arg_cache);
   sema_init (&proc_arg->sema, 0);
   return proc_arg;
 }
@@ -80,7 +93,7 @@ close_exe_file (void)
 static struct process *
 process_create (void)
 {
-  struct process *proc = malloc (sizeof (*proc));
+  struct process *proc = kmem_cache_alloc (process_cache);
   proc->executable = NULL;
   list_init (&proc->children);
 
@@ -102,7 +115,7 @@ process_create (void)
 
 uint32_t
 process_create_fd (struct file *f) {
-  struct file_descriptor *fd = malloc (sizeof (*fd));
+  struct file_descriptor *fd = kmem_cache_alloc (fd_cache);
   fd->id = process_current ()->current_fd_id;
   fd->f = f;
   process_current ()->current_fd_id++;
@@ -128,7 +141,7 @@ process_remove_fd (uint32_t id) {
 
 static void free_fd (struct file_descriptor *fd) {
   file_close (fd->f);
-  free (fd);
+  kmem_cache_free (fd_cache, fd);
 }
 
 struct file *
@@ -187,7 +200,7 @@ process_execute (char *file_name)
 
   bool success = proc_arg->success;
 
-  free (proc_arg);
+  kmem_cache_free (process_arg_cache, proc_arg);
   palloc_free_page (fn_copy);
 
   if (!success || tid == TID_ERROR) {
@@ -331,7 +344,7 @@ process_wait (tid_t child_tid)
   if (child_proc != NULL) {
     sema_down (&child_proc->wait_sema);
     int ret_code = child_proc->return_code;
-    free (child_proc);
+    kmem_cache_free (process_cache, child_proc);
     return ret_code;
   } else {
     return FAIL_ERROR;
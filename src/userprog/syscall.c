@@ -9,8 +9,10 @@
 #include "kernel/console.h"
 
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 #include "devices/shutdown.h"
 
@@ -26,7 +28,7 @@ static struct lock file_lock;
 void
 syscall_init (void)
 {
-  lock_init (&file_lock);
+  lock_init_named (&file_lock, "file_lock");
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -87,6 +89,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 
   uint32_t *args = f->esp;
 
+  TRACE (TRACE_SYSCALL, args[0], 0, 0);
   switch(args[0]) {
     case SYS_EXIT: ;
       validate_user_addr (args + 1);
@@ -101,6 +104,33 @@ syscall_handler (struct intr_frame *f UNUSED)
       validate_user_addr (args + 1);
       f->eax = args[1] + 1;
       break;
+    case SYS_SCHED_LATENCY: ;
+      validate_user_addr (args + 3);
+      int lat_cnt = args[3];
+      unsigned *lat_counts = (unsigned *) args[2];
+      if (lat_cnt > LATENCY_BUCKETS)
+        lat_cnt = LATENCY_BUCKETS;
+      if (lat_cnt > 0)
+        validate_user_addr_range ((char *) lat_counts,
+                                  lat_cnt * sizeof *lat_counts);
+      f->eax = thread_get_latency (args[1], lat_counts, lat_cnt);
+      break;
+    case SYS_PROFILE: ;
+      validate_user_addr (args + 1);
+      if (args[1])
+        f->eax = profile_start ();
+      else
+        {
+          profile_stop ();
+          f->eax = true;
+        }
+      break;
+    case SYS_LOCKSTAT: ;
+      validate_user_addr (args + 2);
+      struct lockstat *ls = (struct lockstat *) args[2];
+      validate_user_addr_range ((char *) ls, sizeof *ls);
+      f->eax = lockstat_get (args[1], ls);
+      break;
     case SYS_HALT: ;
       shutdown_power_off ();
       break;
@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Decodes a kernel trace written by "pintos --trace=FILE" and
+   prints it as a timeline, one event per line.  The layouts
+   below must match those in threads/trace.h.  The trace is in
+   the guest's little-endian byte order, and the fields are
+   naturally aligned, so the same declarations describe it on
+   any little-endian host. */
+
+struct trace_record
+  {
+    uint64_t tsc;
+    uint16_t event;
+    uint16_t tid;
+    uint32_t arg[3];
+  };
+
+struct trace_header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t record_cnt;
+    uint32_t dropped;
+    uint64_t tsc_freq;
+  };
+
+#define TRACE_MAGIC "PINTRACE"
+#define TRACE_VERSION 1
+
+enum trace_event
+  {
+    TRACE_SCHEDULE, TRACE_BLOCK, TRACE_UNBLOCK, TRACE_SEMA_DOWN,
+    TRACE_SEMA_UP, TRACE_INTR_ENTER, TRACE_INTR_EXIT, TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE, TRACE_SYSCALL
+  };
+
+static const char *event_names[] =
+  {
+    "schedule", "block", "unblock", "sema-down", "sema-up",
+    "intr-enter", "intr-exit", "block-read", "block-write", "syscall",
+  };
+
+static const char *status_names[] = {"running", "ready", "blocked", "dying"};
+static const char *block_names[] =
+  {"kernel", "filesys", "scratch", "swap", "raw", "foreign"};
+
+static const char *
+lookup (const char *names[], size_t cnt, uint32_t idx)
+{
+  return idx < cnt ? names[idx] : "?";
+}
+#define LOOKUP(NAMES, IDX) lookup (NAMES, sizeof NAMES / sizeof *NAMES, IDX)
+
+/* Prints R's event name and arguments. */
+static void
+print_event (const struct trace_record *r)
+{
+  const uint32_t *a = r->arg;
+
+  printf ("%-11s ", LOOKUP (event_names, r->event));
+  switch (r->event)
+    {
+    case TRACE_SCHEDULE:
+      printf ("%"PRIu32" -> %"PRIu32" (prev %s)",
+              a[0], a[1], LOOKUP (status_names, a[2]));
+      break;
+    case TRACE_BLOCK:
+    case TRACE_UNBLOCK:
+      printf ("tid %"PRIu32, a[0]);
+      break;
+    case TRACE_SEMA_DOWN:
+    case TRACE_SEMA_UP:
+      printf ("sema %#010"PRIx32" value %"PRIu32, a[0], a[1]);
+      break;
+    case TRACE_INTR_ENTER:
+    case TRACE_INTR_EXIT:
+      printf ("vec %#04"PRIx32, a[0]);
+      break;
+    case TRACE_BLOCK_READ:
+    case TRACE_BLOCK_WRITE:
+      printf ("%s sector %"PRIu32, LOOKUP (block_names, a[0]), a[1]);
+      break;
+    case TRACE_SYSCALL:
+      printf ("nr %"PRIu32, a[0]);
+      break;
+    default:
+      printf ("%"PRIu32" %"PRIu32" %"PRIu32, a[0], a[1], a[2]);
+      break;
+    }
+  putchar ('\n');
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct trace_header h;
+  struct trace_record r;
+  uint64_t first_tsc = 0, prev_tsc = 0;
+  uint32_t i;
+  FILE *f;
+
+  if (argc != 2)
+    {
+      fprintf (stderr,
+               "trace-decode: prints a Pintos kernel trace as a timeline\n"
+               "usage: %s TRACE\n"
+               "  where TRACE was written by \"pintos --trace=TRACE\".\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  f = fopen (argv[1], "rb");
+  if (f == NULL)
+    {
+      fprintf (stderr, "%s: open: %s\n", argv[1], strerror (errno));
+      return EXIT_FAILURE;
+    }
+  if (fread (&h, sizeof h, 1, f) != 1
+      || memcmp (h.magic, TRACE_MAGIC, sizeof h.magic))
+    {
+      fprintf (stderr, "%s: not a Pintos trace\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  if (h.version != TRACE_VERSION || h.record_size != sizeof r)
+    {
+      fprintf (stderr, "%s: unsupported trace version %"PRIu32"\n",
+               argv[1], h.version);
+      return EXIT_FAILURE;
+    }
+
+  printf ("# %"PRIu32" records, %"PRIu32" dropped, %.1f MHz time-stamp counter\n",
+          h.record_cnt, h.dropped, h.tsc_freq / 1e6);
+  printf ("# %12s %10s %5s  event\n", "time (us)", "delta", "tid");
+  for (i = 0; i < h.record_cnt; i++)
+    {
+      if (fread (&r, sizeof r, 1, f) != 1)
+        {
+          fprintf (stderr, "%s: truncated after %"PRIu32" records\n",
+                   argv[1], i);
+          return EXIT_FAILURE;
+        }
+      if (i == 0)
+        first_tsc = prev_tsc = r.tsc;
+
+      /* Without a calibration, print raw cycle counts. */
+      if (h.tsc_freq != 0)
+        printf ("%14.3f %10.3f ", (r.tsc - first_tsc) * 1e6 / h.tsc_freq,
+                (r.tsc - prev_tsc) * 1e6 / h.tsc_freq);
+      else
+        printf ("%14"PRIu64" %10"PRIu64" ", r.tsc - first_tsc,
+                r.tsc - prev_tsc);
+      printf ("%5u  ", r.tid);
+      print_event (&r);
+      prev_tsc = r.tsc;
+    }
+  fclose (f);
+  return EXIT_SUCCESS;
+}